@@ -0,0 +1,291 @@
+#pragma once
+#include "Cell.h"
+#include "Grid.h"
+#include "UnitScan.h"
+#include "Units.h"
+#include <cstdint>
+
+// BatchSweep
+// Grid::sweep() for LANES puzzles at once. The candidate masks are laid out cell by cell with one lane
+// per puzzle, so every step of the sweep - scanning each unit for its solved values and hidden singles,
+// then removing the solved values and solving the singles in each cell - is the same few operations on
+// every puzzle, done a vector at a time: all 16 lanes in one AVX2 vector, or 8 in each of two SSE2
+// halves that go on sweeping on their own. A lane stops changing once its puzzle is solved or found to
+// have a contradiction, and the sweep stops once no lane changes. The easy puzzles that the sweep alone
+// solves need nothing more; the rest are left for the Solver to solve one at a time, from the start,
+// so their results are the same as without the batch. There is no scalar kernel, so on a cpu without
+// SSE2 the batch isn't used at all.
+
+class BatchSweep
+{
+public:
+  typedef Cell::MaskT               MaskT;
+  typedef Units<Grid::SIZE_SUBGRID> UnitsT;
+  typedef Grid::UnitScanT           UnitScanT;
+
+  static const int LANES = 16;
+
+  BatchSweep() : m_masks(), m_placed(), m_singles()
+  {
+  }
+
+  // available
+  // whether this cpu can run the batch
+  //
+  //@param nothing
+  //@return true if there's a vector kernel for it
+  static bool
+  available()
+  {
+    return kernel() != UnitScanT::SCALAR;
+  }
+
+  static UnitScanT::Kernel
+  kernel()
+  {
+    return UnitScanT::best_kernel();
+  }
+
+  // load
+  // puts a puzzle in a lane, with every empty cell given all values as candidates. A lane that nothing
+  // is loaded into has no candidates, so it is a contradiction and is never solved.
+  //
+  //@param lane, puzzle
+  //@return nothing
+  void
+  load( int lane, const Grid& puzzle )
+  {
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const Cell& analysed_cell = puzzle.get_cells()[cell_index];
+      m_masks[cell_index][lane] = analysed_cell.empty() ? Grid::ALL_VALUES : analysed_cell.get_mask();
+    }
+  }
+
+  // sweep
+  // sweeps every lane until none of them changes
+  //
+  //@param nothing
+  //@return a bit for each lane, lane 0 the lowest, set when the sweep solved its puzzle
+  unsigned int
+  sweep()
+  {
+    switch ( kernel() )
+    {
+#if defined( UNIT_SCAN_X86 )
+    case UnitScanT::AVX2:
+      return sweep_avx2();
+    case UnitScanT::SSE2:
+      return sweep_sse2( 0 ) | ( sweep_sse2( LANES / 2 ) << ( LANES / 2 ));
+#endif
+    default:
+      return 0;
+    }
+  }
+
+  // grid
+  // the puzzle in a lane, as far as the sweep got with it
+  //
+  //@param lane
+  //@return the grid
+  Grid
+  grid( int lane ) const
+  {
+    Grid ret;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      ret.cell( cell_index / Grid::SIZE_GRID, cell_index % Grid::SIZE_GRID ).set_candidates( m_masks[cell_index][lane] );
+    }
+    return ret;
+  }
+
+private:
+#if defined( UNIT_SCAN_X86 )
+  // sweep avx2
+  // all of the lanes, in one vector
+  UNIT_SCAN_TARGET( "avx2" ) unsigned int
+  sweep_avx2()
+  {
+    const UnitsT& units = UnitsT::get();
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_cmpeq_epi16( zero, zero );
+    const __m256i one  = _mm256_set1_epi16( 1 );
+    const __m256i all  = _mm256_set1_epi16( static_cast<short>( Grid::ALL_VALUES ));
+    // lanes with a contradiction, all ones
+    __m256i failed = zero;
+    for ( ;; )
+    {
+      for ( int unit = 0; unit < UnitsT::NUM_UNITS; ++unit )
+      {
+        __m256i o = zero;
+        __m256i t = zero;
+        __m256i p = zero;
+        __m256i c = zero;
+        for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+        {
+          const __m256i mask    = load256( m_masks[units.unit_cells[unit][k]] );
+          const __m256i one_bit = _mm256_andnot_si256( _mm256_cmpeq_epi16( mask, zero ),
+                                                       _mm256_cmpeq_epi16( _mm256_and_si256( mask, _mm256_sub_epi16( mask, one )), zero ));
+          const __m256i solved  = _mm256_and_si256( mask, one_bit );
+          t = _mm256_or_si256( t, _mm256_and_si256( o, mask ));
+          o = _mm256_or_si256( o, mask );
+          c = _mm256_or_si256( c, _mm256_and_si256( p, solved ));
+          p = _mm256_or_si256( p, solved );
+        }
+        // every value must have a place in the unit and be solved no more than once
+        const __m256i sound = _mm256_and_si256( _mm256_cmpeq_epi16( o, all ), _mm256_cmpeq_epi16( c, zero ));
+        failed = _mm256_or_si256( failed, _mm256_andnot_si256( sound, ones ));
+        store256( m_placed[unit], p );
+        store256( m_singles[unit], _mm256_andnot_si256( t, o ));
+      }
+
+      __m256i changed = zero;
+      for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+      {
+        const int ( &cell_units )[UnitsT::UNITS_PER_CELL] = units.cell_units[cell_index];
+        const __m256i mask    = load256( m_masks[cell_index] );
+        const __m256i one_bit = _mm256_andnot_si256( _mm256_cmpeq_epi16( mask, zero ),
+                                                     _mm256_cmpeq_epi16( _mm256_and_si256( mask, _mm256_sub_epi16( mask, one )), zero ));
+        const __m256i placed  = _mm256_and_si256( mask, _mm256_or_si256( _mm256_or_si256( load256( m_placed[cell_units[0]] ), load256( m_placed[cell_units[1]] )),
+                                                                         load256( m_placed[cell_units[2]] )));
+        const __m256i single  = _mm256_and_si256( mask, _mm256_or_si256( _mm256_or_si256( load256( m_singles[cell_units[0]] ), load256( m_singles[cell_units[1]] )),
+                                                                         load256( m_singles[cell_units[2]] )));
+        const __m256i no_single = _mm256_cmpeq_epi16( single, zero );
+        const __m256i remaining = _mm256_andnot_si256( placed, _mm256_or_si256( single, _mm256_and_si256( no_single, mask )));
+        // solved cells are left alone, as their own value is among the placed ones
+        const __m256i updated   = _mm256_or_si256( _mm256_and_si256( one_bit, mask ), _mm256_andnot_si256( one_bit, remaining ));
+        // an unsolved cell with no candidates left, or that is the only place for two values
+        const __m256i several   = _mm256_andnot_si256( _mm256_or_si256( no_single, _mm256_cmpeq_epi16( _mm256_and_si256( single, _mm256_sub_epi16( single, one )), zero )), ones );
+        failed  = _mm256_or_si256( failed, _mm256_or_si256( _mm256_cmpeq_epi16( updated, zero ), _mm256_andnot_si256( one_bit, several )));
+        changed = _mm256_or_si256( changed, _mm256_andnot_si256( _mm256_cmpeq_epi16( updated, mask ), ones ));
+        store256( m_masks[cell_index], updated );
+      }
+      if ( _mm256_testz_si256( _mm256_andnot_si256( failed, changed ), ones ))
+      {
+        break;
+      }
+    }
+
+    __m256i solved = ones;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const __m256i mask = load256( m_masks[cell_index] );
+      solved = _mm256_and_si256( solved, _mm256_cmpeq_epi16( _mm256_and_si256( mask, _mm256_sub_epi16( mask, one )), zero ));
+    }
+    return lane_bits( static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_andnot_si256( failed, solved ))), LANES );
+  }
+
+  UNIT_SCAN_TARGET( "avx2" ) static __m256i
+  load256( const MaskT* masks )
+  {
+    return _mm256_load_si256( reinterpret_cast<const __m256i*>( masks ));
+  }
+
+  UNIT_SCAN_TARGET( "avx2" ) static void
+  store256( MaskT* masks, __m256i value )
+  {
+    _mm256_store_si256( reinterpret_cast<__m256i*>( masks ), value );
+  }
+
+  // sweep sse2
+  // the same as sweep_avx2(), for the half of the lanes that starts at first
+  UNIT_SCAN_TARGET( "sse2" ) unsigned int
+  sweep_sse2( int first )
+  {
+    const UnitsT& units = UnitsT::get();
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_cmpeq_epi16( zero, zero );
+    const __m128i one  = _mm_set1_epi16( 1 );
+    const __m128i all  = _mm_set1_epi16( static_cast<short>( Grid::ALL_VALUES ));
+    __m128i failed = zero;
+    for ( ;; )
+    {
+      for ( int unit = 0; unit < UnitsT::NUM_UNITS; ++unit )
+      {
+        __m128i o = zero;
+        __m128i t = zero;
+        __m128i p = zero;
+        __m128i c = zero;
+        for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+        {
+          const __m128i mask    = load128( &m_masks[units.unit_cells[unit][k]][first] );
+          const __m128i one_bit = _mm_andnot_si128( _mm_cmpeq_epi16( mask, zero ),
+                                                    _mm_cmpeq_epi16( _mm_and_si128( mask, _mm_sub_epi16( mask, one )), zero ));
+          const __m128i solved  = _mm_and_si128( mask, one_bit );
+          t = _mm_or_si128( t, _mm_and_si128( o, mask ));
+          o = _mm_or_si128( o, mask );
+          c = _mm_or_si128( c, _mm_and_si128( p, solved ));
+          p = _mm_or_si128( p, solved );
+        }
+        const __m128i sound = _mm_and_si128( _mm_cmpeq_epi16( o, all ), _mm_cmpeq_epi16( c, zero ));
+        failed = _mm_or_si128( failed, _mm_andnot_si128( sound, ones ));
+        store128( &m_placed[unit][first], p );
+        store128( &m_singles[unit][first], _mm_andnot_si128( t, o ));
+      }
+
+      __m128i changed = zero;
+      for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+      {
+        const int ( &cell_units )[UnitsT::UNITS_PER_CELL] = units.cell_units[cell_index];
+        const __m128i mask    = load128( &m_masks[cell_index][first] );
+        const __m128i one_bit = _mm_andnot_si128( _mm_cmpeq_epi16( mask, zero ),
+                                                  _mm_cmpeq_epi16( _mm_and_si128( mask, _mm_sub_epi16( mask, one )), zero ));
+        const __m128i placed  = _mm_and_si128( mask, _mm_or_si128( _mm_or_si128( load128( &m_placed[cell_units[0]][first] ), load128( &m_placed[cell_units[1]][first] )),
+                                                                   load128( &m_placed[cell_units[2]][first] )));
+        const __m128i single  = _mm_and_si128( mask, _mm_or_si128( _mm_or_si128( load128( &m_singles[cell_units[0]][first] ), load128( &m_singles[cell_units[1]][first] )),
+                                                                   load128( &m_singles[cell_units[2]][first] )));
+        const __m128i no_single = _mm_cmpeq_epi16( single, zero );
+        const __m128i remaining = _mm_andnot_si128( placed, _mm_or_si128( single, _mm_and_si128( no_single, mask )));
+        const __m128i updated   = _mm_or_si128( _mm_and_si128( one_bit, mask ), _mm_andnot_si128( one_bit, remaining ));
+        const __m128i several   = _mm_andnot_si128( _mm_or_si128( no_single, _mm_cmpeq_epi16( _mm_and_si128( single, _mm_sub_epi16( single, one )), zero )), ones );
+        failed  = _mm_or_si128( failed, _mm_or_si128( _mm_cmpeq_epi16( updated, zero ), _mm_andnot_si128( one_bit, several )));
+        changed = _mm_or_si128( changed, _mm_andnot_si128( _mm_cmpeq_epi16( updated, mask ), ones ));
+        store128( &m_masks[cell_index][first], updated );
+      }
+      if ( _mm_movemask_epi8( _mm_andnot_si128( failed, changed )) == 0 )
+      {
+        break;
+      }
+    }
+
+    __m128i solved = ones;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const __m128i mask = load128( &m_masks[cell_index][first] );
+      solved = _mm_and_si128( solved, _mm_cmpeq_epi16( _mm_and_si128( mask, _mm_sub_epi16( mask, one )), zero ));
+    }
+    return lane_bits( static_cast<unsigned int>( _mm_movemask_epi8( _mm_andnot_si128( failed, solved ))), LANES / 2 );
+  }
+
+  UNIT_SCAN_TARGET( "sse2" ) static __m128i
+  load128( const MaskT* masks )
+  {
+    return _mm_load_si128( reinterpret_cast<const __m128i*>( masks ));
+  }
+
+  UNIT_SCAN_TARGET( "sse2" ) static void
+  store128( MaskT* masks, __m128i value )
+  {
+    _mm_store_si128( reinterpret_cast<__m128i*>( masks ), value );
+  }
+#endif
+
+  // lane bits
+  // a byte mask from movemask, two bits for each 16-bit lane, as one bit for each lane
+  static unsigned int
+  lane_bits( unsigned int byte_mask, int lanes )
+  {
+    unsigned int ret = 0;
+    for ( int lane = 0; lane < lanes; ++lane )
+    {
+      ret |= (( byte_mask >> ( 2 * lane )) & 1u ) << lane;
+    }
+    return ret;
+  }
+
+  // the candidates of each cell, lane by lane
+  alignas( 32 ) MaskT m_masks[Grid::NUM_CELLS][LANES];
+  // each unit's solved values and hidden singles, from the last scan
+  alignas( 32 ) MaskT m_placed[UnitsT::NUM_UNITS][LANES];
+  alignas( 32 ) MaskT m_singles[UnitsT::NUM_UNITS][LANES];
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include "Cell.h"
+#include "Grid.h"
+#include <array>
+#include <string>
+
+// Canonical
+// the canonical form of a puzzle. Puzzles that are the same up to relabelling the digits, transposing
+// the board and reordering its bands and stacks have the same form, so one solve serves them all. Each
+// of the 72 layouts (transposed or not, by 6 band orders, by 6 stack orders) is read row by row with
+// the digits relabelled in the order they first appear, and the smallest reading is the form. The
+// transform that produced it is kept, so a grid solved in canonical form can be mapped back.
+//
+// Reordering the rows within a band or the columns within a stack would find more of the copies, but
+// multiplies the layouts by 6^6 and costs more than the solve it saves.
+
+class Canonical
+{
+public:
+  // an empty form, for a place to put one
+  Canonical() : m_key(), m_source(), m_labels()
+  {
+  }
+
+  explicit Canonical( const Grid& puzzle ) : m_key( Grid::NUM_CELLS, static_cast<char>( '0' + Grid::SIZE_GRID + 1 )), m_source(), m_labels()
+  {
+    int values[Grid::NUM_CELLS];
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const Cell& analysed_cell = puzzle.get_cells()[cell_index];
+      values[cell_index] = analysed_cell.solved() ? analysed_cell.get_solution() : 0;
+    }
+
+    static const int ORDERS[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+    for ( int transposed = 0; transposed < 2; ++transposed )
+    {
+      for ( const auto& bands : ORDERS )
+      {
+        for ( const auto& stacks : ORDERS )
+        {
+          try_layout( values, transposed != 0, bands, stacks );
+        }
+      }
+    }
+  }
+
+  // key
+  // the canonical form as NUM_CELLS characters, '0' for an empty cell, equal for equivalent puzzles
+  //
+  //@param nothing
+  //@return the key
+  const std::string&
+  key() const
+  {
+    return m_key;
+  }
+
+  // canonical grid
+  // the puzzle in canonical form, ready to solve
+  //
+  //@param nothing
+  //@return the grid
+  Grid
+  canonical_grid() const
+  {
+    Grid grid;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      grid.set_given( cell_index, m_key[cell_index] );
+    }
+    return grid;
+  }
+
+  // restore
+  // maps a grid in canonical form, solved or not, back to the layout and digits of the original
+  // puzzle, candidates and all
+  //
+  //@param grid in canonical form
+  //@return the grid as the original puzzle has it
+  Grid
+  restore( const Grid& canonical ) const
+  {
+    int digits[Grid::SIZE_GRID + 1];
+    for ( int digit = 1; digit <= Grid::SIZE_GRID; ++digit )
+    {
+      digits[m_labels[digit]] = digit;
+    }
+    Grid grid;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const Cell::MaskT mask = canonical.get_cells()[cell_index].get_mask();
+      Cell::MaskT restored = mask & Cell::EMPTY_MASK;
+      for ( int label = 1; label <= Grid::SIZE_GRID; ++label )
+      {
+        if ( mask & Cell::bit( label ))
+        {
+          restored |= Cell::bit( digits[label] );
+        }
+      }
+      grid.cell( m_source[cell_index] / Grid::SIZE_GRID, m_source[cell_index] % Grid::SIZE_GRID ).set_candidates( restored );
+    }
+    return grid;
+  }
+
+private:
+  // try layout
+  // reads the puzzle in one layout, and keeps it if it is smaller than the best so far. The reading
+  // gives up at the first character that is larger.
+  //
+  //@param the puzzle's values, whether transposed, band order, stack order
+  //@return nothing
+  void
+  try_layout( const int* values, bool transposed, const int* bands, const int* stacks )
+  {
+    std::array<unsigned char, Grid::NUM_CELLS> source;
+    std::array<int, Grid::SIZE_GRID + 1> labels = {};
+    char key[Grid::NUM_CELLS];
+    int  next_label = 1;
+    bool smaller    = false;
+    for ( int row = 0; row < Grid::SIZE_GRID; ++row )
+    {
+      const int source_row = ( 3 * bands[row / 3] ) + ( row % 3 );
+      for ( int col = 0; col < Grid::SIZE_GRID; ++col )
+      {
+        const int source_col = ( 3 * stacks[col / 3] ) + ( col % 3 );
+        const int cell_index = Grid::index( row, col );
+        source[cell_index] = static_cast<unsigned char>( transposed ? Grid::index( source_col, source_row ) : Grid::index( source_row, source_col ));
+        const int value = values[source[cell_index]];
+        if ( value != 0 && labels[value] == 0 )
+        {
+          labels[value] = next_label++;
+        }
+        key[cell_index] = static_cast<char>( '0' + ( value != 0 ? labels[value] : 0 ));
+        if ( !smaller )
+        {
+          if ( key[cell_index] > m_key[cell_index] )
+          {
+            return;
+          }
+          smaller = key[cell_index] < m_key[cell_index];
+        }
+      }
+    }
+    if ( !smaller )
+    {
+      return;
+    }
+    // digits the puzzle doesn't use take the labels that are left, in order
+    for ( int digit = 1; digit <= Grid::SIZE_GRID; ++digit )
+    {
+      if ( labels[digit] == 0 )
+      {
+        labels[digit] = next_label++;
+      }
+    }
+    m_key.assign( key, Grid::NUM_CELLS );
+    m_source = source;
+    m_labels = labels;
+  }
+
+  // the canonical form
+  std::string m_key;
+  // the original cell that each cell of the canonical form was read from
+  std::array<unsigned char, Grid::NUM_CELLS> m_source;
+  // the canonical label of each original digit
+  std::array<int, Grid::SIZE_GRID + 1> m_labels;
+};
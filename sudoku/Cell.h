@@ -2,61 +2,286 @@
 #include <set>
 #include <boost/assign/list_of.hpp>
 #include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <algorithm>
+#include <type_traits>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
 
-class Cell
+// CellMask
+// the smallest unsigned type with a bit for each value of a grid with subgrids of SUBGRID x SUBGRID
+// cells, and one more for the empty marker: 16 bits up to 9x9 boards (and 15 values), 32 up to 31 values,
+// which covers 16x16 and 25x25, and 64 beyond that.
+
+template <int SUBGRID>
+struct CellMask
+{
+  static const int BITS = ( SUBGRID * SUBGRID ) + 1;
+  static_assert( SUBGRID >= 2 && BITS <= 64, "no mask type is wide enough" );
+
+  typedef typename std::conditional<BITS <= 16, std::uint16_t,
+          typename std::conditional<BITS <= 32, std::uint32_t, std::uint64_t>::type>::type type;
+};
+
+// The candidates of a cell are held in a mask, bit n being set when n is still a candidate. Bit 0 is
+// the "empty" marker that an unfilled cell starts with, in the same way as the value 0 was used when
+// the candidates lived in a std::set<int>. The cell is a template on the subgrid size so that the mask
+// is only as wide as the board needs; Cell is the cell of the usual 9x9 board.
+
+template <int SUBGRID>
+class BasicCell
 {
 public:
+  typedef typename CellMask<SUBGRID>::type MaskT;
 
-  Cell(void) : m_candidates()
+  static const MaskT EMPTY_MASK = 1;
+
+  static MaskT
+  bit( int value )
   {
-    m_candidates.insert( 0 );
+    return static_cast<MaskT>( MaskT( 1 ) << value );
   }
-  explicit Cell( int value ) : m_candidates()
+
+  static int
+  popcount( MaskT mask )
   {
-    if ( value != 0 )
+#if defined( __GNUC__ )
+    return sizeof( MaskT ) <= sizeof( unsigned int ) ? __builtin_popcount( static_cast<unsigned int>( mask ))
+                                                     : __builtin_popcountll( mask );
+#else
+    if ( sizeof( MaskT ) <= sizeof( std::uint16_t ))
     {
-      m_candidates.clear();
-      m_candidates.insert( value );
-    } 
+      unsigned int m = static_cast<unsigned int>( mask );
+      m = m - (( m >> 1 ) & 0x5555u );
+      m = ( m & 0x3333u ) + (( m >> 2 ) & 0x3333u );
+      m = ( m + ( m >> 4 )) & 0x0f0fu;
+      return static_cast<int>(( m + ( m >> 8 )) & 0x1fu );
+    }
+    std::uint64_t m = mask;
+    m = m - (( m >> 1 ) & 0x5555555555555555ull );
+    m = ( m & 0x3333333333333333ull ) + (( m >> 2 ) & 0x3333333333333333ull );
+    m = ( m + ( m >> 4 )) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<int>(( m * 0x0101010101010101ull ) >> 56 );
+#endif
   }
-  explicit Cell( const Cell& rhs )
+
+  // the character a value is written as, the one BasicGrid::value_of() reads: digits up to 9 and
+  // letters from 'A' for 10, with '0' for no value
+  static char
+  char_of( int value )
   {
-    m_candidates = rhs.m_candidates;
+    return static_cast<char>( value < 10 ? '0' + value : 'A' + ( value - 10 ));
   }
 
-  Cell& 
-  operator=( int value )
+  // index of the lowest set bit, mask must not be 0
+  static int
+  lowest_bit( MaskT mask )
+  {
+#if defined( __GNUC__ )
+    return sizeof( MaskT ) <= sizeof( unsigned int ) ? __builtin_ctz( static_cast<unsigned int>( mask ))
+                                                     : __builtin_ctzll( mask );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index;
+    _BitScanForward64( &index, mask );
+    return static_cast<int>( index );
+#elif defined( _MSC_VER )
+    unsigned long index;
+    if ( sizeof( MaskT ) > sizeof( unsigned long ) && static_cast<unsigned long>( mask ) == 0 )
+    {
+      _BitScanForward( &index, static_cast<unsigned long>( static_cast<std::uint64_t>( mask ) >> 32 ));
+      return static_cast<int>( index ) + 32;
+    }
+    _BitScanForward( &index, static_cast<unsigned long>( mask ));
+    return static_cast<int>( index );
+#else
+    int index = 0;
+    while ( !( mask & 1u ))
+    {
+      mask >>= 1;
+      ++index;
+    }
+    return index;
+#endif
+  }
+
+  // read-only, set-like view of a candidate mask so that callers can keep iterating, counting and
+  // comparing candidates as they did with the std::set<int>. It holds a copy of the mask, so it
+  // stays valid when the cell changes.
+  class Candidates
+  {
+  public:
+    class const_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef int                       value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef const int*                pointer;
+      typedef int                       reference;
+
+      explicit const_iterator( MaskT remaining = 0 ) : m_remaining( remaining )
+      {
+      }
+
+      int
+      operator*() const
+      {
+        return lowest_bit( m_remaining );
+      }
+
+      const_iterator&
+      operator++()
+      {
+        m_remaining &= static_cast<MaskT>( m_remaining - 1 );
+        return *this;
+      }
+
+      const_iterator
+      operator++( int )
+      {
+        const_iterator previous( *this );
+        ++*this;
+        return previous;
+      }
+
+      bool
+      operator==( const const_iterator& rhs ) const
+      {
+        return m_remaining == rhs.m_remaining;
+      }
+
+      bool
+      operator!=( const const_iterator& rhs ) const
+      {
+        return m_remaining != rhs.m_remaining;
+      }
+
+    private:
+      MaskT m_remaining;
+    };
+
+    typedef const_iterator iterator;
+    typedef int            value_type;
+
+    explicit Candidates( MaskT mask ) : m_mask( mask )
+    {
+    }
+
+    const_iterator
+    begin() const
+    {
+      return const_iterator( m_mask );
+    }
+
+    const_iterator
+    end() const
+    {
+      return const_iterator();
+    }
+
+    std::size_t
+    size() const
+    {
+      return static_cast<std::size_t>( popcount( m_mask ));
+    }
+
+    bool
+    empty() const
+    {
+      return m_mask == 0;
+    }
+
+    std::size_t
+    count( int value ) const
+    {
+      return ( m_mask & bit( value )) ? 1 : 0;
+    }
+
+    MaskT
+    mask() const
+    {
+      return m_mask;
+    }
+
+    bool
+    operator==( const Candidates& rhs ) const
+    {
+      return m_mask == rhs.m_mask;
+    }
+
+    bool
+    operator!=( const Candidates& rhs ) const
+    {
+      return m_mask != rhs.m_mask;
+    }
+
+    // lexicographical, as std::set<int> compared
+    bool
+    operator<( const Candidates& rhs ) const
+    {
+      return std::lexicographical_compare( begin(), end(), rhs.begin(), rhs.end() );
+    }
+
+  private:
+    MaskT m_mask;
+  };
+
+  BasicCell(void) : m_candidates( EMPTY_MASK )
+  {
+  }
+
+  explicit BasicCell( int value ) : m_candidates( 0 )
   {
     if ( value != 0 )
     {
-      m_candidates.clear();
-      m_candidates.insert( value );
+      m_candidates = bit( value );
     }
-    return *this;
   }
 
-  bool 
-  operator==( const Cell& rhs )
+  BasicCell&
+  operator=( int value )
   {
-    if ( this != &rhs )
+    if ( value != 0 )
     {
-      return this->m_candidates == rhs.m_candidates;
+      m_candidates = bit( value );
     }
-    return true;
+    return *this;
+  }
+
+  bool
+  operator==( const BasicCell& rhs ) const
+  {
+    return m_candidates == rhs.m_candidates;
+  }
+
+  Candidates
+  get_candidates() const
+  {
+    return Candidates( m_candidates );
+  }
+
+  MaskT
+  get_mask() const
+  {
+    return m_candidates;
   }
 
-  const std::set<int>& 
-  get_candidates() const 
-  { 
-    return m_candidates; 
+  std::size_t
+  size() const
+  {
+    return static_cast<std::size_t>( popcount( m_candidates ));
   }
 
-  int 
-  get_solution() const 
-  { 
-    if ( solved() ) 
+  int
+  get_solution() const
+  {
+    if ( solved() )
     {
-      return *(m_candidates.begin());
+      return lowest_bit( m_candidates );
     }
     else
     {
@@ -64,63 +289,74 @@ public:
     }
   }
 
-  void 
+  void
   add_candidate( int value )
   {
-    m_candidates.insert( value );
+    m_candidates |= bit( value );
   }
 
-  void 
+  void
   remove_candidate( int value )
   {
-    m_candidates.erase( value );
+    m_candidates &= static_cast<MaskT>( ~bit( value ));
+  }
+
+  // remove every candidate in mask, returns true if anything was removed
+  bool
+  remove_candidates( MaskT mask )
+  {
+    const MaskT before = m_candidates;
+    m_candidates &= static_cast<MaskT>( ~mask );
+    return m_candidates != before;
+  }
+
+  // replace the candidates with those in mask
+  void
+  set_candidates( MaskT mask )
+  {
+    m_candidates = mask;
   }
 
   // take all of the candidates of one cell and copy them into one in the grid
-  void 
-  add_candidates( const std::set<std::shared_ptr<Cell>>& candidates)
+  void
+  add_candidates( const std::set<std::shared_ptr<BasicCell>>& candidates)
   {
-    if ( empty() && candidates.size() > 0 )
-    {
-      remove_candidate( 0 );
-    }
-   
-    m_candidates.clear();
-    for( const auto i : candidates )
+    m_candidates = 0;
+    for( const auto& i : candidates )
     {
       add_candidate( i->get_solution());
-    } 
+    }
   }
-  
-  bool 
+
+  bool
   solved() const
   {
-    return ( m_candidates.size() == 1 && 
-             *m_candidates.begin() != 0 );
+    // exactly one bit set, and it isn't the empty marker
+    return ( m_candidates & ( m_candidates - 1 )) == 0 &&
+           m_candidates > EMPTY_MASK;
   }
-  
 
-  bool 
-  empty() const
-  {
-    return ( m_candidates.size() == 1 &&
-             *m_candidates.begin() == 0  );
-  }
 
-  ~Cell(void)
+  bool
+  empty() const
   {
+    return m_candidates == EMPTY_MASK;
   }
 
 private:
-  std::set<int> m_candidates;
-  friend std::ostream& operator<<( std::ostream& out, Cell& cell );
+  MaskT m_candidates;
 
 };
 
-std::ostream& operator<<( std::ostream& out, Cell& cell )
+typedef BasicCell<3> Cell;
+
+template <int SUBGRID>
+inline std::ostream& operator<<( std::ostream& out, BasicCell<SUBGRID>& cell )
 {
-  std::for_each( cell.m_candidates.begin(), cell.m_candidates.end(), 
-    [&]( int candidate ){ out << candidate << ", "; });
+  for( const auto candidate : cell.get_candidates() )
+  {
+    out << BasicCell<SUBGRID>::char_of( candidate ) << ", ";
+  }
   return out;
 }
 
@@ -0,0 +1,78 @@
+#pragma once
+#include "Trace.h"
+#include <atomic>
+
+// Deadline
+// when a solve has to stop: a time it has to be done by, a flag that another thread can raise to
+// cancel it, or both. Both solvers check it as they go and, once it has expired, give up at the next
+// check with what they have so far. A default constructed deadline never expires. Once a check has
+// found it expired it stays expired, so that afterwards the solve's caller can tell from gave_up()
+// whether it gave up or finished, however late it finished. That makes checking one a change, so
+// each thread of a solve checks its own copy; the flag is what they share.
+
+class Deadline
+{
+public:
+  Deadline() : m_at( Clock::time_point::max() ), m_cancel( 0 ), m_expired( false )
+  {
+  }
+
+  explicit Deadline( Clock::time_point at, const std::atomic<bool>* cancel = 0 ) : m_at( at ), m_cancel( cancel ), m_expired( false )
+  {
+  }
+
+  // after
+  // the deadline for a solve that starts now
+  //
+  //@param how long it may take, zero for as long as it likes, the flag that cancels it, if any
+  //@return the deadline
+  static Deadline
+  after( Clock::duration budget, const std::atomic<bool>* cancel = 0 )
+  {
+    return Deadline( budget > Clock::duration::zero() ? Clock::now() + budget : Clock::time_point::max(), cancel );
+  }
+
+  // limited
+  // whether the deadline can expire at all, solvers needn't check one that can't
+  //
+  //@param nothing
+  //@return true if there is a time or a flag
+  bool
+  limited() const
+  {
+    return m_cancel != 0 || m_at != Clock::time_point::max();
+  }
+
+  // expired
+  // whether the time has passed or the flag has been raised
+  //
+  //@param nothing
+  //@return true once the solve should give up
+  bool
+  expired() const
+  {
+    if ( !m_expired )
+    {
+      m_expired = ( m_cancel != 0 && m_cancel->load( std::memory_order_relaxed )) ||
+                  ( m_at != Clock::time_point::max() && Clock::now() >= m_at );
+    }
+    return m_expired;
+  }
+
+  // gave up
+  // whether a check has found the deadline expired, without checking it again, so that a solve that
+  // finished just after the time isn't taken to have given up
+  //
+  //@param nothing
+  //@return true if a solve that checked it stopped because of it
+  bool
+  gave_up() const
+  {
+    return m_expired;
+  }
+
+private:
+  Clock::time_point         m_at;
+  const std::atomic<bool>*  m_cancel;
+  mutable bool              m_expired;
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include "Grid.h"
+#include "Solver.h"
+#include "Stats.h"
+#include "Technique.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+// Rating
+// how hard a puzzle is for the solver: the least it takes to solve, from hidden singles alone up to
+// guessing, and for a puzzle that needs guessing, how many guesses the search made
+
+struct Rating
+{
+  enum Level
+  {
+    // solved by removing candidates and hidden singles, the sweep on its own
+    EASY,
+    // solved by logic, with naked pairs and subsets as well
+    MEDIUM,
+    // solved with no more than HARD_GUESSES guesses
+    HARD,
+    // takes more guesses than that
+    FIENDISH,
+    NUM_LEVELS
+  };
+
+  static const Stats::CountT HARD_GUESSES = 8;
+
+  Level level;
+  // the stats of solving it with the default techniques
+  Stats stats;
+
+  static const char*
+  name( Level level )
+  {
+    static const char* const names[NUM_LEVELS] = { "easy", "medium", "hard", "fiendish" };
+    return names[level];
+  }
+};
+
+// Generator
+// makes random puzzles with unique solutions. A full grid is made by filling the three subgrids on the
+// diagonal, which don't share a unit, with random orders of the values, and solving the rest by
+// guessing. The clues of the puzzle are then taken away one at a time in a random order, each one only
+// if the puzzle still has a unique solution without it, so the puzzle that is left is minimal: every
+// clue it has is needed. A generator is seeded from a seed and an index together, so the puzzles of a
+// run are the same however many threads make them.
+
+class Generator
+{
+public:
+  Generator( unsigned int seed, unsigned int index ) : m_rng()
+  {
+    std::seed_seq sequence = { seed, index };
+    m_rng.seed( sequence );
+  }
+
+  // solution
+  // a random full grid
+  //
+  //@param nothing
+  //@return the grid
+  Grid
+  solution()
+  {
+    int values[Grid::SIZE_GRID];
+    std::iota( values, values + Grid::SIZE_GRID, 1 );
+    Grid grid;
+    for ( int subgrid = 0; subgrid < Grid::SIZE_SUBGRID; ++subgrid )
+    {
+      std::shuffle( values, values + Grid::SIZE_GRID, m_rng );
+      for ( int k = 0; k < Grid::SIZE_GRID; ++k )
+      {
+        const int row = ( subgrid * Grid::SIZE_SUBGRID ) + ( k / Grid::SIZE_SUBGRID );
+        const int col = ( subgrid * Grid::SIZE_SUBGRID ) + ( k % Grid::SIZE_SUBGRID );
+        grid.set_given( Grid::index( row, col ), static_cast<char>( '0' + values[k] ));
+      }
+    }
+    // the diagonal subgrids can always be completed, so this never fails
+    grid.solve_by_guessing();
+    return grid;
+  }
+
+  // puzzle
+  // a minimal puzzle whose unique solution is the given grid
+  //
+  //@param a full grid
+  //@return the puzzle
+  Grid
+  puzzle( const Grid& solution )
+  {
+    SolveOptions options;
+    options.batch          = false;
+    options.solution_limit = 2;
+    const Solver checker( options );
+
+    int values[Grid::NUM_CELLS];
+    int order[Grid::NUM_CELLS];
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      values[cell_index] = solution.get_cells()[cell_index].get_solution();
+      order[cell_index]  = cell_index;
+    }
+    std::shuffle( order, order + Grid::NUM_CELLS, m_rng );
+    for ( int cell_index : order )
+    {
+      const int value = values[cell_index];
+      values[cell_index] = 0;
+      if ( !checker.solve( grid_of( values )).unique() )
+      {
+        values[cell_index] = value;
+      }
+    }
+    return grid_of( values );
+  }
+
+  // rate
+  // solves a puzzle with more and more techniques until it is solved
+  //
+  //@param the puzzle, which must have a solution
+  //@return its rating
+  static Rating
+  rate( const Grid& puzzle )
+  {
+    Rating rating;
+    SolveOptions options;
+    options.batch      = false;
+    options.instrument = true;
+    options.techniques = Technique::DEFAULT & ~( Technique::bit( Technique::SOLVE_FOR_NAKED_PAIRS ) | Technique::bit( Technique::SOLVE_BY_GUESSING ));
+    if ( Solver( options ).solve( puzzle ).status == SolveResult::SOLVED )
+    {
+      rating.level = Rating::EASY;
+    }
+    else
+    {
+      options.techniques = Technique::ALL & ~Technique::bit( Technique::SOLVE_BY_GUESSING );
+      rating.level = Solver( options ).solve( puzzle ).status == SolveResult::SOLVED ? Rating::MEDIUM : Rating::HARD;
+    }
+    options.techniques = Technique::DEFAULT;
+    rating.stats = Solver( options ).solve( puzzle ).stats;
+    if ( rating.level == Rating::HARD && rating.stats.guesses > Rating::HARD_GUESSES )
+    {
+      rating.level = Rating::FIENDISH;
+    }
+    return rating;
+  }
+
+private:
+  static Grid
+  grid_of( const int* values )
+  {
+    Grid grid;
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      grid.set_given( cell_index, static_cast<char>( '0' + values[cell_index] ));
+    }
+    return grid;
+  }
+
+  std::mt19937 m_rng;
+};
@@ -1,16 +1,20 @@
 #pragma once
-#include "cell.h"
+#include "Cell.h"
+#include "Units.h"
+#include "Timings.h"
+#include "Stats.h"
+#include "UnitScan.h"
+#include "Deadline.h"
 #include <memory>
 #include <vector>
 #include <fstream>
-#include <strstream>
 #include <string>
 #include <algorithm>
 #include <boost/assign/list_of.hpp>
 #include <iterator>
 #include <iostream>
-#include <map>
-#include <boost/range/irange.hpp>
+#include <array>
+#include <type_traits>
 
 
 // @file
@@ -34,347 +38,215 @@
 //
 // The Grid...
 // RCS - Row, Column or Subgrid
+//
+// The grid is a template on the size of its subgrids, so that the mask type, the unit tables and the
+// work queues are all fixed at compile time for each board: BasicGrid<2> is a 4x4 board, Grid, a
+// BasicGrid<3>, the usual 9x9, BasicGrid<4> 16x16 and BasicGrid<5> 25x25.
 
-
-class Grid
+template <int SUBGRID>
+class BasicGrid
 {
 public:
-  static const int SIZE_SUBGRID = 3;
+  typedef BasicCell<SUBGRID>        CellT;
+  typedef typename CellT::MaskT       MaskT;
+  typedef typename CellT::Candidates  CandidatesT;
+
+  static const int SIZE_SUBGRID = SUBGRID;
   static const int SIZE_GRID    = SIZE_SUBGRID * SIZE_SUBGRID;
   static const int NUM_CELLS    = SIZE_GRID * SIZE_GRID;
+  // the candidate mask of a cell that could still be any value
+  static const MaskT ALL_VALUES = static_cast<MaskT>((( MaskT( 1 ) << SIZE_GRID ) - 1 ) << 1 );
+  // the largest naked or hidden subset solve_for_subsets() looks for
+  static const int MAX_SUBSET = 4;
 
-  struct mless
-		: public std::binary_function<std::shared_ptr<Cell>, std::shared_ptr<Cell>, bool>
-	{	// functor for operator<
-	bool operator()(const std::shared_ptr<Cell>& left, const std::shared_ptr<Cell>& right) const
-		{	
-      return left->get_candidates() < right->get_candidates();
-		}
-	};
-  typedef std::set<std::shared_ptr<Cell>, mless> SetPtrCellLessT;
-
-
-  struct cellless
-		: public std::binary_function<std::shared_ptr<Cell>, std::shared_ptr<Cell>, bool>
-	{	// functor for operator<
-	bool operator()(const std::shared_ptr<Cell>& left, const std::shared_ptr<Cell>& right) const
-		{	
-      return left.get() < right.get();
-		}
-	};
-
-
-  typedef std::set<std::shared_ptr<Cell>, cellless> SetPtrCellPtrLessT;
+  typedef std::array<CellT, NUM_CELLS> CellArrayT;
+  // cells are referred to by their index, row * SIZE_GRID + col
+  typedef Units<SIZE_SUBGRID>         UnitsT;
+  typedef UnitScan<SIZE_SUBGRID>      UnitScanT;
 
+  static int
+  index( int row, int col )
+  {
+    return ( row * SIZE_GRID ) + col;
+  }
 
-  Grid(void)
+  static int
+  row_of( int index )
   {
-    m_cells.resize( SIZE_GRID );
+    return index / SIZE_GRID;
+  }
 
-    for ( const auto row : boost::irange( 0, SIZE_GRID ))
-    {
-      m_cells[row].resize( SIZE_GRID );
-      for ( const auto col : boost::irange( 0, SIZE_GRID ))
-      {
-        Cell* new_cell = new Cell;
-        m_cells[row][col] = std::shared_ptr<Cell>(new_cell);
-        m_map_cell_to_row_col[ new_cell ] = std::make_pair( row, col );
-      }
-    }
+  static int
+  col_of( int index )
+  {
+    return index % SIZE_GRID;
   }
 
-  Grid( const Grid& rhs )
+  // Worklist
+  // the cells that have just been solved and the units whose candidates have changed since they were last
+  // looked at. Each cell is only ever solved once, and a unit is only queued while it isn't already waiting,
+  // so both queues are fixed size and live on the stack. It also carries the timings and stats, if any,
+  // that the techniques add to, the set of techniques that may be used and the deadline, if any.
+  class Worklist
   {
-    m_cells.resize( SIZE_GRID );
+  public:
+    explicit Worklist( Timings* timings = 0, Stats* stats = 0, Technique::SetT techniques = Technique::DEFAULT,
+                       const Deadline* deadline = 0 )
+      : m_solved_head( 0 ), m_solved_tail( 0 ), m_unit_head( 0 ), m_unit_count( 0 ), m_unit_queued(), m_unit_changed(),
+        m_timings( timings ), m_stats( stats ), m_techniques( techniques ), m_deadline( deadline ), m_checks( 0 )
+    {
+    }
 
-    for ( const auto row : boost::irange( 0, SIZE_GRID ))
+    const Deadline*
+    deadline() const
     {
-      m_cells[row].resize( SIZE_GRID );
-      for ( const auto col : boost::irange( 0, SIZE_GRID ))
-      {
-        Cell* new_cell = new Cell( *rhs.m_cells[row][col].get() );
-        m_cells[row][col] = std::shared_ptr<Cell>(new_cell);
-        m_map_cell_to_row_col[ new_cell ] = std::make_pair( row, col );
-      }
+      return m_deadline;
     }
-  }
 
-  std::set<std::shared_ptr<Cell>, mless> 
-  get_solved_RCS( int row, int col )
-  {
-    std::set<std::shared_ptr<Cell>, mless> solved_rcs_set;
-    // rows and columns
-    for( int i = 0; i < SIZE_GRID; ++i )
-    { 
-      std::shared_ptr<Cell>& temp1_cell_ptr = m_cells[row][i];
-      if ( temp1_cell_ptr->solved() )
-      {
-        solved_rcs_set.insert( temp1_cell_ptr );
-      }
-      std::shared_ptr<Cell>& temp2_cell_ptr = m_cells[i][col];
-      if ( temp2_cell_ptr->solved() )
-      {
-        solved_rcs_set.insert( temp2_cell_ptr );
-      }
+    // out of time
+    // whether the deadline, if any, has expired. Propagation asks for every unit it searches, but the
+    // clock is only read every CHECK_INTERVAL times, as reading it costs about as much as the search
+    //
+    //@param nothing
+    //@return true if the solve should give up
+    bool
+    out_of_time()
+    {
+      return m_deadline != 0 && ( m_checks++ % CHECK_INTERVAL ) == 0 && m_deadline->expired();
     }
-    //subgrids
-    for( int i = 0; i < SIZE_SUBGRID; ++i )
+
+    Technique::SetT
+    techniques() const
     {
-      for( int j = 0; j < SIZE_SUBGRID; ++j )
-      {
-        std::shared_ptr<Cell>& temp3_cell_ptr = m_cells[((row / SIZE_SUBGRID) * SIZE_SUBGRID ) + i][(( col / SIZE_SUBGRID ) * SIZE_SUBGRID ) + j];
-        if ( temp3_cell_ptr->solved() )
-        {
-          solved_rcs_set.insert( temp3_cell_ptr );
-        }
-      }
+      return m_techniques;
     }
-    return solved_rcs_set;
-  }
 
-  std::set<std::shared_ptr<Cell>> 
-  get_unsolved_RCS( int row, int col )
-  {
-    std::set<std::shared_ptr<Cell>> rcs_set;
-    // rows and columns
-    for( int i = 0; i < SIZE_GRID; ++i )
-    { 
-      std::shared_ptr<Cell>& temp1_cell_ptr = m_cells[row][i];
-      if( !temp1_cell_ptr->solved())
-      {
-        rcs_set.insert( temp1_cell_ptr );
-      }
-      std::shared_ptr<Cell>& temp2_cell_ptr = m_cells[i][col];
-      if( !temp2_cell_ptr->solved())
-      {
-        rcs_set.insert( temp2_cell_ptr );
-      }
-      
+    bool
+    uses( Technique::Type technique ) const
+    {
+      return ( m_techniques & Technique::bit( technique )) != 0;
     }
-    //subgrids
-    for( int i = 0; i < SIZE_SUBGRID; ++i )
+
+    Timings*
+    timings() const
     {
-      for( int j = 0; j < SIZE_SUBGRID; ++j )
-      {
-        std::shared_ptr<Cell>& temp3_cell_ptr = m_cells[((row / SIZE_SUBGRID) * SIZE_SUBGRID ) + i][(( col / SIZE_SUBGRID ) * SIZE_SUBGRID ) + j];
-        if( !temp3_cell_ptr->solved())
-        {
-          rcs_set.insert( temp3_cell_ptr );
-        }
-      }
+      return m_timings;
     }
-    return rcs_set;
-  }
-  
-  std::set<std::shared_ptr<Cell>>
-  get_row_cells( int row, int exclude_column )
-  {
-    std::set<std::shared_ptr<Cell>> row_cells;
-    for( int i = 0; i < SIZE_GRID; ++i )
+
+    Stats*
+    stats() const
     {
-      std::shared_ptr<Cell>& temp_cell_ptr = m_cells[row][i];
-      if ( i != exclude_column )
-      {
-        row_cells.insert( temp_cell_ptr ); 
-      }
+      return m_stats;
     }
-    return row_cells;
-  }
 
-  std::set<std::shared_ptr<Cell>> 
-  get_col_cells( int exclude_row, int col )
-  {
-    std::set<std::shared_ptr<Cell>> col_cells;
-    for( int i = 0; i < SIZE_GRID; ++i )
+    void
+    clear()
     {
-      std::shared_ptr<Cell>& temp_cell_ptr = m_cells[i][col];
-      if ( i != exclude_row )
-      {
-        col_cells.insert( temp_cell_ptr ); 
-      }
+      m_solved_head = m_solved_tail = 0;
+      m_unit_head   = m_unit_count  = 0;
+      m_unit_queued.clear();
+      m_unit_changed.clear();
     }
-    return col_cells;
-  }
 
-  std::set<std::shared_ptr<Cell>>
-  get_subgrid_cells( int row, int col )
-  {
-    std::set<std::shared_ptr<Cell>> subgrid_cells;
+    void
+    push_solved( int cell_index )
+    {
+      m_solved[m_solved_tail++] = cell_index;
+    }
 
-    for( int i = 0; i < SIZE_SUBGRID; ++i )
+    bool
+    has_solved() const
     {
-      for( int j = 0; j < SIZE_SUBGRID; ++j )
-      {
-        std::shared_ptr<Cell>& temp_cell_ptr = m_cells[((row / SIZE_SUBGRID) * SIZE_SUBGRID ) + i][(( col / SIZE_SUBGRID ) * SIZE_SUBGRID ) + j];
-        if ( temp_cell_ptr != m_cells[row][col] )
-        {
-          subgrid_cells.insert( temp_cell_ptr );
-        }
-      }
+      return m_solved_head != m_solved_tail;
     }
-    return subgrid_cells;
-  }
 
-  std::set<int>
-  get_row_values( int row, int exclude_column )
-  {
-    std::set<int> row_values;
-    for( int i = 0; i < SIZE_GRID; ++i )
+    int
+    pop_solved()
     {
-      if ( i != exclude_column )
-      {
-        row_values.insert( m_cells[row][i]->get_candidates().begin(), 
-                           m_cells[row][i]->get_candidates().end());
-      }
+      return m_solved[m_solved_head++];
     }
-    return row_values;
-  }
 
-  std::set<int>
-  get_col_values( int exclude_row, int col )
-  {
-    std::set<int> col_values;
-    for( int i = 0; i < SIZE_GRID; ++i )
+    void
+    push_unit( int unit )
     {
-      if ( i != exclude_row )
+      m_unit_changed.set( unit );
+      if( !m_unit_queued.test( unit ))
       {
-        col_values.insert( m_cells[i][col]->get_candidates().begin(), 
-                           m_cells[i][col]->get_candidates().end());
+        m_unit_queued.set( unit );
+        m_units[( m_unit_head + m_unit_count++ ) % UnitsT::NUM_UNITS] = unit;
       }
     }
-    return col_values;
-  }
-  
-  std::set<int>
-  get_subgrid_values( int row, int col )
-  {
-    std::set<int> subgrid_values;
 
-    for( int i = 0; i < SIZE_SUBGRID; ++i )
+    bool
+    has_unit() const
     {
-      for( int j = 0; j < SIZE_SUBGRID; ++j )
-      {
-        std::shared_ptr<Cell>& temp_cell_ptr = m_cells[((row / SIZE_SUBGRID) * SIZE_SUBGRID ) + i][(( col / SIZE_SUBGRID ) * SIZE_SUBGRID ) + j];
-        if ( temp_cell_ptr != m_cells[row][col] )
-        {
-          subgrid_values.insert( temp_cell_ptr->get_candidates().begin(), 
-                                 temp_cell_ptr->get_candidates().end());
-        }
-      }
+      return m_unit_count != 0;
     }
-    return subgrid_values;
-  }
 
-  bool
-  solve_for_subgrid()
-  {
-    for( int row = 0; row < SIZE_GRID; ++row )
+    int
+    pop_unit()
     {
-      for( int col = 0; col < SIZE_GRID; ++col )
-      {
-        if( !m_cells[row][col]->solved() )
-        {
-          std::set<int> subgrid_cell_values      = get_subgrid_values( row, col );
-          std::shared_ptr<Cell> analysed_cell    = m_cells[row][col];
-          std::set<int> analysed_cell_candidates = m_cells[row][col]->get_candidates();
-          if( subgrid_cell_values.size() != SIZE_GRID )
-          {
-            for(const auto analysed_cell_candidates_value :  analysed_cell_candidates)
-            {
-               if ( subgrid_cell_values.find( analysed_cell_candidates_value ) == subgrid_cell_values.end())
-               {
-                 *analysed_cell = analysed_cell_candidates_value;
-               }
-             }
-          }
-          if ( m_cells[row][col]->solved() )
-          {
-            row = 0;
-            col = -1;
-          }
-        }
-      }
+      const int unit = m_units[m_unit_head];
+      m_unit_head = ( m_unit_head + 1 ) % UnitsT::NUM_UNITS;
+      --m_unit_count;
+      m_unit_queued.reset( unit );
+      return unit;
     }
-    return true;
-  }
-  
 
-  void
-  solve_for_col()
-  {
-    for( int row = 0; row < SIZE_GRID; ++row )
+    // take changed
+    // whether a unit has been queued since it was last taken, that is whether its candidates have
+    // changed since solve_for_subsets() last looked at it
+    //
+    //@param unit
+    //@return true if it has changed
+    bool
+    take_changed( int unit )
     {
-      for( int col = 0; col < SIZE_GRID; ++col )
-      {
-        if( !m_cells[row][col]->solved() )
-        {
-          std::set<int> col_cell_values          = get_col_values( row, col );
-          std::shared_ptr<Cell> analysed_cell    = m_cells[row][col];
-          std::set<int> analysed_cell_candidates = m_cells[row][col]->get_candidates();
-          if( col_cell_values.size() != SIZE_GRID )
-          {
-            for( const auto analysed_cell_candidates_value : analysed_cell_candidates )
-            {
-              if ( col_cell_values.find( analysed_cell_candidates_value ) == col_cell_values.end())
-              {
-                *analysed_cell = analysed_cell_candidates_value;
-              }
-            }
-          }
-          if ( m_cells[row][col]->solved() )
-          {
-            row = 0;
-            col = -1;
-          }
-        }
-      }
+      const bool changed = m_unit_changed.test( unit );
+      m_unit_changed.reset( unit );
+      return changed;
     }
+
+  private:
+    typedef UnitSet<UnitsT::NUM_UNITS> UnitBitsT;
+
+    int       m_solved[NUM_CELLS];
+    int       m_solved_head;
+    int       m_solved_tail;
+    int       m_units[UnitsT::NUM_UNITS];
+    int       m_unit_head;
+    int       m_unit_count;
+    UnitBitsT m_unit_queued;
+    UnitBitsT m_unit_changed;
+    Timings*        m_timings;
+    Stats*          m_stats;
+    Technique::SetT m_techniques;
+    const Deadline* m_deadline;
+    unsigned int    m_checks;
+
+    static const unsigned int CHECK_INTERVAL = 64;
+  };
+
+  BasicGrid(void) : m_cells()
+  {
   }
- 
-  void
-  solve_for_row()
+
+  CellT&
+  cell( int row, int col )
   {
-    //row
-    // for each candidate of each cell go over the rest of the row's cells' candidates to see if it's unique
-    for( int row = 0; row < SIZE_GRID; ++row )
-    {
-      for( int col = 0; col < SIZE_GRID; ++col )
-      {
-        if( !m_cells[row][col]->solved() )
-        {
-          std::set<int>         row_cell_values          = get_row_values( row, col );
-          std::shared_ptr<Cell> analysed_cell            = m_cells[row][col];
-          std::set<int>         analysed_cell_candidates = m_cells[row][col]->get_candidates(); 
-
-          if( row_cell_values.size() != SIZE_GRID )
-          {
-            for(const auto analysed_cell_candidates_value : analysed_cell_candidates )
-            {
-              if ( row_cell_values.find( analysed_cell_candidates_value ) == row_cell_values.end())
-              {
-                *analysed_cell = analysed_cell_candidates_value;
-              }
-            }
-          }
-          if ( m_cells[row][col]->solved() )
-          {
-            row = 0;
-            col = -1;
-          }
-        }
-      }
-    }
+    return m_cells[index( row, col )];
   }
- 
 
-  const std::vector<std::vector<std::shared_ptr<Cell>>>&
-  get_cells() const 
+  const CellT&
+  cell( int row, int col ) const
   {
-    return m_cells; 
+    return m_cells[index( row, col )];
   }
 
-  ~Grid(void)
+  const CellArrayT&
+  get_cells() const 
   {
+    return m_cells; 
   }
 
   std::vector<int> 
@@ -383,338 +255,830 @@ public:
     std::vector<int> ret_vec;
     for( int col = 0; col < number; ++col )
     {
-      ret_vec.push_back( m_cells[0][col]->get_solution() );
+      ret_vec.push_back( cell( 0, col ).get_solution() );
     }
     return ret_vec;
   }
 
-   void
-   initialise()
+   // initialise
+   // gives every empty cell all values as candidates and sweeps the whole grid, then queues every unit
+   // so that the first propagate() looks at all of them for naked pairs. A grid the sweep solves queues
+   // nothing. Candidates that have already been eliminated stay eliminated.
+   //
+   //@param worklist to seed
+   //@return false if the sweep found a contradiction
+   bool
+   initialise( Worklist& worklist )
+   {
+     {
+       Timings::Scope scope( worklist.timings(), Technique::INITIALISE );
+       worklist.clear();
+       for( CellT& analysed_cell : m_cells )
+       {
+         if( analysed_cell.empty() )
+         {
+           analysed_cell.set_candidates( ALL_VALUES );
+         }
+       }
+     }
+     if( !sweep( worklist ))
+     {
+       return false;
+     }
+     if( !solved() )
+     {
+       for( int unit = 0; unit < UnitsT::NUM_UNITS; ++unit )
+       {
+         worklist.push_unit( unit );
+       }
+     }
+     return true;
+   }
+
+   // sweep
+   // remove_candidates() and solve_for_unit() for the whole grid at once: every unit is scanned for its
+   // solved values and hidden singles in one UnitScan, the solved values are removed from each unsolved
+   // cell and the hidden singles are solved, until a scan changes nothing. The cells are changed directly
+   // rather than through the worklist, as the next scan sees everything anyway.
+   //
+   //@param worklist for the timings and stats
+   //@return false if a value has no place left in a unit, is solved twice in one, or a cell has no candidates
+   bool
+   sweep( Worklist& worklist )
    {
-     // get feasible candidates (from rows, columns and subgrids) for each empty cell, if only one fill in / if only one of that number in each rcs, fill in.
-     for( int row = 0; row < SIZE_GRID; ++row )
+     Timings::Scope scope( worklist.timings(), Technique::SWEEP );
+     const UnitsT& units = UnitsT::get();
+     Stats* stats = worklist.stats();
+     UnitScanT scan;
+     for( bool changed = true; changed; )
      {
-       for( int col = 0; col < SIZE_GRID; ++col )
+       changed = false;
+       scan.scan( m_cells.data() );
+       if( stats )
        {
-         const std::set<int>& candidates = m_cells[row][col]->get_candidates();
-         typedef std::set<std::shared_ptr<Cell>> SetPtrCellT;
-         SetPtrCellT result_set;
-         if( !m_cells[row][col]->solved() )
+         stats->units_searched += UnitsT::NUM_UNITS;
+       }
+       for( int unit = 0; unit < UnitsT::NUM_UNITS; ++unit )
+       {
+         if( scan.once[unit] != ALL_VALUES || scan.clashes[unit] != 0 )
          {
-           std::set<std::shared_ptr<Cell>, mless> rcs = get_solved_RCS( row, col);
-           for ( int i = 1; i < 10; ++i )
+           return false;
+         }
+       }
+       for( int cell_index = 0; cell_index < NUM_CELLS; ++cell_index )
+       {
+         CellT& analysed_cell = m_cells[cell_index];
+         if( analysed_cell.solved() )
+         {
+           continue;
+         }
+         const int ( &cell_units )[UnitsT::UNITS_PER_CELL] = units.cell_units[cell_index];
+         const MaskT mask      = analysed_cell.get_mask();
+         const MaskT placed    = mask & ( scan.placed[cell_units[0]] | scan.placed[cell_units[1]] | scan.placed[cell_units[2]] );
+         const MaskT single    = mask & ( scan.singles( cell_units[0] ) | scan.singles( cell_units[1] ) | scan.singles( cell_units[2] ));
+         const MaskT remaining = ( single != 0 ? single : mask ) & static_cast<MaskT>( ~placed );
+         // two values that can only go in this cell are a contradiction even if they leave it as it is
+         if( remaining == 0 || ( single != 0 && CellT::popcount( single ) != 1 ))
+         {
+           return false;
+         }
+         if( remaining == mask )
+         {
+           continue;
+         }
+         if( stats )
+         {
+           stats->eliminated[Technique::REMOVE_CANDIDATES] += CellT::popcount( placed );
+           if( single != 0 )
            {
-             std::shared_ptr<Cell> val_to_find( new Cell(i) );
-             auto iter = rcs.find( val_to_find );
-             if ( iter == rcs.end() )
+             int single_unit = 0;
+             while( !( scan.singles( cell_units[single_unit] ) & single ))
              {
-               result_set.insert( val_to_find );
+               ++single_unit;
              }
-           }
-           m_cells[row][col]->add_candidates( result_set ); 
-           if ( m_cells[row][col]->solved() )
-           {
-             row = 0;
-             col = -1;
+             stats->eliminated[Technique::for_unit( cell_units[single_unit], SIZE_GRID )] += CellT::popcount( mask & static_cast<MaskT>( ~( placed | single )));
            }
          }
+         analysed_cell.set_candidates( remaining );
+         changed = true;
        }
      }
+     return true;
    }
 
- 
-   // remove_candidates
-   // if a cell is not solved, it will check its rcs for solved cells and remove the value for the solved cell from the this cell
-   // 
-   // @param nothing
-   // @return nothing
-   void remove_candidates()
+   // propagate
+   // works through the worklist until nothing is left on it: the solution of each newly solved cell is
+   // removed from its rcs, then each unit whose candidates changed is searched for hidden singles and
+   // naked pairs. Only the cells and units that changed are looked at again. Once that has run out, the
+   // units that changed are searched for subsets, which are dearer to find and rarely there.
+   //
+   //@param worklist, as seeded by initialise() or eliminate()
+   //@return false if a contradiction was found, or the deadline expired
+   bool
+   propagate( Worklist& worklist )
    {
-     for ( const auto row : boost::irange( 0, SIZE_GRID ))
+     if( worklist.stats() )
+     {
+       ++worklist.stats()->propagations;
+     }
+     for( ;; )
      {
-       for ( const auto col : boost::irange( 0, SIZE_GRID ))
+       if( worklist.has_solved() )
        {
-         const std::set<int>& candidates = m_cells[row][col]->get_candidates();
-         if( !m_cells[row][col]->solved() )
+         Timings::Scope scope( worklist.timings(), Technique::REMOVE_CANDIDATES );
+         while( worklist.has_solved() )
          {
-           std::set<std::shared_ptr<Cell>, mless> rcs = get_solved_RCS( row, col);
-           for( const auto& rcs_iter : rcs )
+           if( !remove_candidates( worklist, worklist.pop_solved() ))
            {
-             if( rcs_iter->solved() )
-             {
-               //removing the solution of the solved cell from the analysed cell
-               m_cells[row][col]->remove_candidate( rcs_iter->get_solution() );
-             }
+             return false;
            }
          }
        }
+       if( !worklist.has_unit() )
+       {
+         if( !worklist.uses( Technique::SOLVE_FOR_SUBSETS ))
+         {
+           return true;
+         }
+         // the cheaper techniques have run out, so look for subsets in the units that changed since
+         // the last look, until one of them eliminates something for the cheaper techniques to follow up
+         Timings::Scope scope( worklist.timings(), Technique::SOLVE_FOR_SUBSETS );
+         for( int unit = 0; unit < UnitsT::NUM_UNITS && !worklist.has_unit(); ++unit )
+         {
+           if( worklist.take_changed( unit ) && !solve_for_subsets( worklist, unit ))
+           {
+             return false;
+           }
+         }
+         if( !worklist.has_unit() )
+         {
+           return true;
+         }
+         continue;
+       }
+       if( worklist.out_of_time() )
+       {
+         return false;
+       }
+       const int unit = worklist.pop_unit();
+       if( worklist.stats() )
+       {
+         ++worklist.stats()->units_searched;
+       }
+       {
+         Timings::Scope scope( worklist.timings(), Technique::for_unit( unit, SIZE_GRID ));
+         if( !solve_for_unit( worklist, unit ))
+         {
+           return false;
+         }
+       }
+       if( worklist.uses( Technique::SOLVE_FOR_NAKED_PAIRS ))
+       {
+         Timings::Scope scope( worklist.timings(), Technique::SOLVE_FOR_NAKED_PAIRS );
+         if( !solve_for_naked_pairs( worklist, unit ))
+         {
+           return false;
+         }
+       }
      }
    }
 
-   std::set<std::shared_ptr<Cell>>
-   intersect( const std::set<std::shared_ptr<Cell>>& first, 
-              const std::set<std::shared_ptr<Cell>>& second )
+   // eliminate
+   // removes candidates from a cell and queues whatever that affects
+   //
+   //@param worklist to queue on, index of the cell, candidates to remove, technique that eliminated them
+   //@return false if the cell has no candidates left
+   bool
+   eliminate( Worklist& worklist, int cell_index, MaskT mask, Technique::Type technique )
    {
-     std::set<std::shared_ptr<Cell>> result;
+     CellT& analysed_cell = m_cells[cell_index];
+     const MaskT before = analysed_cell.get_mask();
+     if( !analysed_cell.remove_candidates( mask ))
+     {
+       return true;
+     }
+     if( worklist.stats() )
+     {
+       worklist.stats()->eliminated[technique] += CellT::popcount( before & mask );
+     }
+     if( analysed_cell.get_mask() == 0 )
+     {
+       return false;
+     }
+     for( const int unit : UnitsT::get().cell_units[cell_index] )
+     {
+       worklist.push_unit( unit );
+     }
+     if( analysed_cell.solved() )
+     {
+       worklist.push_solved( cell_index );
+     }
+     return true;
+   }
 
-     std::set_intersection( first.begin(), first.end(),
-                            second.begin(), second.end(),
-                            std::inserter( result, result.end() ));
+   // assign
+   // solves a cell with the given value by eliminating all of its other candidates
+   //
+   //@param worklist to queue on, index of the cell, value, technique that found it
+   //@return false if value wasn't a candidate
+   bool
+   assign( Worklist& worklist, int cell_index, int value, Technique::Type technique )
+   {
+     if( !( m_cells[cell_index].get_mask() & CellT::bit( value )))
+     {
+       return false;
+     }
+     return eliminate( worklist, cell_index, static_cast<MaskT>( ~CellT::bit( value )), technique );
+   }
 
+   // remove_candidates
+   // removes the solution of a solved cell from the cells in its rcs
+   //
+   //@param worklist to queue on, index of the solved cell
+   //@return false if a cell in the rcs was left without candidates
+   bool
+   remove_candidates( Worklist& worklist, int solved_index )
+   {
+     const MaskT solution = m_cells[solved_index].get_mask();
+     for( const int peer : UnitsT::get().peers[solved_index] )
+     {
+       if( ( m_cells[peer].get_mask() & solution ) && !eliminate( worklist, peer, solution, Technique::REMOVE_CANDIDATES ))
+       {
+         return false;
+       }
+     }
+     return true;
+   }
 
-     return result;
+   // solve for unit
+   // a value that is a candidate of only one cell in a row, column or subgrid is that cell's solution,
+   // this is what solve_for_row/col/subgrid did for the whole grid
+   //
+   //@param worklist to queue on, unit to search
+   //@return false if a value has no place left in the unit, or one cell is the only place for two values
+   bool
+   solve_for_unit( Worklist& worklist, int unit )
+   {
+     const int ( &unit_cells )[SIZE_GRID] = UnitsT::get().unit_cells[unit];
+     MaskT once  = 0;
+     MaskT twice = 0;
+     for( const int unit_cell : unit_cells )
+     {
+       const MaskT mask = m_cells[unit_cell].get_mask();
+       twice |= once & mask;
+       once  |= mask;
+     }
+     if( once != ALL_VALUES )
+     {
+       return false;
+     }
+     const MaskT singles = once & static_cast<MaskT>( ~twice );
+     if( singles == 0 )
+     {
+       return true;
+     }
+     for( const int unit_cell : unit_cells )
+     {
+       const CellT& analysed_cell = m_cells[unit_cell];
+       const MaskT single  = analysed_cell.get_mask() & singles;
+       if( single != 0 && !analysed_cell.solved() )
+       {
+         if( CellT::popcount( single ) != 1 ||
+             !assign( worklist, unit_cell, CellT::lowest_bit( single ), Technique::for_unit( unit, SIZE_GRID )))
+         {
+           return false;
+         }
+       }
+     }
+     return true;
    }
 
    // solve for naked pairs
-   // eliminates more candidates, when two cells with an intersection in rcs, both with the same two candidates, those two candidates can be removed from
-   // all cells with the same intersection of rcs. Similar to remove_candidates() but in pairs.
+   // eliminates more candidates, when two cells in a unit both have the same two candidates, those two candidates can be
+   // removed from all of the other cells in the unit. Similar to remove_candidates() but in pairs.
    //
-   //@param  nothing
-   //@return nothing
-   void
-   solve_for_naked_pairs()
+   //@param  worklist to queue on, unit to search
+   //@return false if a cell was left without candidates
+   bool
+   solve_for_naked_pairs( Worklist& worklist, int unit )
    {
-     for ( const auto row : boost::irange( 0, SIZE_GRID ))
+     const int ( &unit_cells )[SIZE_GRID] = UnitsT::get().unit_cells[unit];
+     for( int i = 0; i < SIZE_GRID; ++i )
      {
-       for ( const auto col : boost::irange( 0, SIZE_GRID ))
+       const MaskT pair = m_cells[unit_cells[i]].get_mask();
+       if( CellT::popcount( pair ) != 2 )
        {
-         std::shared_ptr<Cell> analysed_cell = m_cells[row][col];
-         std::set<std::shared_ptr<Cell>> first_rcs = get_unsolved_RCS( row, col);
-         first_rcs.erase( m_cells[row][col]);
-
-
-         if( m_cells[row][col]->get_candidates().size() == 2 )
+         continue;
+       }
+       for( int j = i + 1; j < SIZE_GRID; ++j )
+       {
+         if( m_cells[unit_cells[j]].get_mask() != pair )
+         {
+           continue;
+         }
+         for( int k = 0; k < SIZE_GRID; ++k )
          {
-           for( std::set<std::shared_ptr<Cell>>::iterator rcs_iter = first_rcs.begin();
-             rcs_iter != first_rcs.end();
-             ++rcs_iter)
+           if( k != i && k != j && !eliminate( worklist, unit_cells[k], pair, Technique::SOLVE_FOR_NAKED_PAIRS ))
            {
-             std::shared_ptr<Cell> rcs_cells = *rcs_iter;
-             if( (*rcs_iter)->get_candidates().size() == 2)
-             {
-               if(  m_cells[row][col]->get_candidates() == (*rcs_iter)->get_candidates() )
-               {
-                 std::pair<int, int>& row_col = m_map_cell_to_row_col[ rcs_iter->get() ];
-                 std::set<std::shared_ptr<Cell>> second_rcs = get_unsolved_RCS( row_col.first, row_col.second );
-                 second_rcs.erase( m_cells[row_col.first][row_col.second]);
-                 std::set<std::shared_ptr<Cell>> intercept = intersect( first_rcs, second_rcs );
-                 std::pair< int, int > pair;
-                 std::set<int>::iterator cand_iter = m_cells[row][col]->get_candidates().begin();
-                 pair.first  =  *cand_iter++;
-                 pair.second =  *cand_iter;
-                 for( const auto& intercept_value : intercept )
-                 {
-                   intercept_value->remove_candidate( pair.first );
-                   intercept_value->remove_candidate( pair.second );
-                 }
-               }
-             }
+             return false;
            }
          }
+         break;
        }
      }
+     return true;
    }
 
-   // solve for hidden pairs
-   // similar to solve_for_row/column/subgrid but in pairs, if the pair of candidates in a pair of cells appears once in the intersection of rcs
-   // then all other candidates can be removed from the analysed cells apart from the pair.
+   // solve for subsets
+   // naked and hidden subsets of 2 to MAX_SUBSET in a unit. A naked subset is k cells that only have k
+   // candidates between them, which the unit's other cells can't then have; a hidden subset is k values
+   // that only have k places between them, which can't then have any other candidates. Both are found
+   // by find_subset() from masks, the candidates of each unsolved cell for naked subsets and the places
+   // of each value, a mask over the unit's cells, for hidden ones. A naked subset of k among n unsolved
+   // cells leaves a hidden subset of n - k and the other way round, so sizes up to n / 2 find them all.
+   // The search stops at the first subset that eliminates anything, as the unit is queued again.
    //
-   //@param nothing
-   //@return nothing
-   void
-   solve_for_hidden_pairs()
+   //@param  worklist to queue on, unit to search
+   //@return false if k cells have fewer than k candidates between them, or k values fewer than k places
+   bool
+   solve_for_subsets( Worklist& worklist, int unit )
    {
-     for ( const auto row : boost::irange( 0, SIZE_GRID ))
+     const int ( &unit_cells )[SIZE_GRID] = UnitsT::get().unit_cells[unit];
+     MaskT masks[SIZE_GRID];
+     MaskT places[SIZE_GRID + 1] = {};
+     MaskT unsolved_slots = 0;
+     for( int slot = 0; slot < SIZE_GRID; ++slot )
      {
-       for ( const auto col : boost::irange( 0, SIZE_GRID ))
+       const CellT& analysed_cell = m_cells[unit_cells[slot]];
+       masks[slot] = analysed_cell.get_mask();
+       if( !analysed_cell.solved() )
        {
-         std::set<int> candidates = m_cells[row][col]->get_candidates();
-         std::set<std::shared_ptr<Cell>> first_rcs = get_unsolved_RCS( row, col);
-         std::pair< int, int > pair;
-         for( const auto& rcs_iter : first_rcs )
+         unsolved_slots |= CellT::bit( slot );
+         for( const int value : analysed_cell.get_candidates() )
          {
-           //if two cells in the rcs contains 2 candidates that are the same and that are unique to the intercept of the rcs,
-           //remove all candidates other than those two.
-           std::set<int> candidates2 = rcs_iter->get_candidates();
-           int counter = 0;
-           for( const auto& candidates2_iter : candidates2 )
-           {
-             for( const auto& candidates_iter : candidates )
-             {
-               if( candidates_iter == candidates2_iter )
-               {
-                 ++counter;
-                 if( counter == 1 )
-                 {
-                   pair.first = candidates_iter;
-                 }
-                 if( counter == 2)
-                 {
-                   pair.second = candidates_iter;
-                 }
-               }
-             }
-           }
-           if( counter == 2 )
-           {
-             std::pair<int, int>& row_col                      = m_map_cell_to_row_col[ rcs_iter.get() ];
-             std::set<std::shared_ptr<Cell>> row_set           = get_row_cells( row, col );
-             std::set<std::shared_ptr<Cell>> row_set2          = get_row_cells( row_col.first, row_col.second );
-             std::set<std::shared_ptr<Cell>> row_intercept     = intersect( row_set, row_set2 );
-             std::set<std::shared_ptr<Cell>> col_set           = get_col_cells( row, col );
-             std::set<std::shared_ptr<Cell>> col_set2          = get_col_cells( row_col.first, row_col.second );
-             std::set<std::shared_ptr<Cell>> col_intercept     = intersect( col_set, col_set2 );
-             std::set<std::shared_ptr<Cell>> subgrid_set       = get_subgrid_cells( row, col );
-             std::set<std::shared_ptr<Cell>> subgrid_set2      = get_subgrid_cells( row_col.first, row_col.second );
-             std::set<std::shared_ptr<Cell>> subgrid_intercept = intersect( subgrid_set, subgrid_set2 );
-             if( row_intercept.size() != 0 )
-             {
-               for( const auto& row_intercept_iter : row_intercept )
-               {
-                 std::set<int> row_candidates = row_intercept_iter->get_candidates();
-                 for( const auto& row_candidates_iter : row_candidates )
-                 {
-                   if( row_candidates_iter != pair.first && row_candidates_iter != pair.second )
-                   {
-                     candidates.clear();
-                     candidates.insert( pair.first );
-                     candidates.insert( pair.second );
-                     candidates2.clear();
-                     candidates2.insert( pair.first );
-                     candidates2.insert( pair.second );
-                   }
-                 }
-               }
-             }
+           places[value] |= CellT::bit( slot );
+         }
+       }
+     }
+     const int halves  = CellT::popcount( unsolved_slots ) / 2;
+     const int largest = halves < MAX_SUBSET ? halves : MAX_SUBSET;
+     if( largest < 2 )
+     {
+       return true;
+     }
 
-             if( subgrid_intercept.size() != 0 )
-             {
-               for( const auto& subgrid_intercept_iter : subgrid_intercept )
-               {
-                 std::set<int> subgrid_candidates = subgrid_intercept_iter->get_candidates();
-                 for( const auto& subgrid_candidates_iter : subgrid_candidates )
-                 {
-                   if( subgrid_candidates_iter != pair.first && subgrid_candidates_iter != pair.second )
-                   {
-                     candidates.clear();
-                     candidates.insert( pair.first );
-                     candidates.insert( pair.second );
-                     candidates2.clear();
-                     candidates2.insert( pair.first );
-                     candidates2.insert( pair.second );
-                   }
-                 }
-               }
-             }
+     // naked subsets, of the cells with few enough candidates
+     MaskT sets[SIZE_GRID];
+     int         members[SIZE_GRID];
+     int         count = 0;
+     for( const int slot : CandidatesT( unsolved_slots ))
+     {
+       if( CellT::popcount( masks[slot] ) <= largest )
+       {
+         sets[count]      = masks[slot];
+         members[count++] = slot;
+       }
+     }
+     bool contradiction = false;
+     MaskT in_subset = 0;
+     const unsigned int naked = find_subset( sets, count, largest, 0u, 0, 0, 0, [&]( unsigned int subset, MaskT values )
+     {
+       in_subset = 0;
+       for( const int i : CandidatesT( static_cast<MaskT>( subset )))
+       {
+         in_subset |= CellT::bit( members[i] );
+       }
+       for( const int slot : CandidatesT( unsolved_slots & static_cast<MaskT>( ~in_subset )))
+       {
+         if( masks[slot] & values )
+         {
+           return true;
+         }
+       }
+       return false;
+     }, contradiction );
+     if( contradiction )
+     {
+       return false;
+     }
+     if( naked != 0 )
+     {
+       MaskT values = 0;
+       for( const int i : CandidatesT( static_cast<MaskT>( naked )))
+       {
+         values |= sets[i];
+       }
+       for( const int slot : CandidatesT( unsolved_slots & static_cast<MaskT>( ~in_subset )))
+       {
+         if( !eliminate( worklist, unit_cells[slot], values, Technique::SOLVE_FOR_SUBSETS ))
+         {
+           return false;
+         }
+       }
+       return true;
+     }
 
-             if( col_intercept.size() != 0 )
-             {
-               for( const auto& col_intercept_iter : col_intercept )
-               {
-                 std::set<int> col_candidates = col_intercept_iter->get_candidates();
-                 for( const auto& col_candidates_iter : col_candidates )
-                 {
-                   if( col_candidates_iter != pair.first && col_candidates_iter != pair.second )
-                   {
-                     candidates.clear();
-                     candidates.insert( pair.first );
-                     candidates.insert( pair.second );
-                     candidates2.clear();
-                     candidates2.insert( pair.first );
-                     candidates2.insert( pair.second );
-                   }
-                 }
-               }
-             }
-           }
+     // hidden subsets, of the values with few enough places
+     count = 0;
+     for( int value = 1; value <= SIZE_GRID; ++value )
+     {
+       const int size = CellT::popcount( places[value] );
+       if( size >= 2 && size <= largest )
+       {
+         sets[count]      = places[value];
+         members[count++] = value;
+       }
+     }
+     MaskT others = 0;
+     const unsigned int hidden = find_subset( sets, count, largest, 0u, 0, 0, 0, [&]( unsigned int subset, MaskT slots )
+     {
+       others = ALL_VALUES;
+       for( const int i : CandidatesT( static_cast<MaskT>( subset )))
+       {
+         others &= static_cast<MaskT>( ~CellT::bit( members[i] ));
+       }
+       for( const int slot : CandidatesT( slots ))
+       {
+         if( masks[slot] & others )
+         {
+           return true;
+         }
+       }
+       return false;
+     }, contradiction );
+     if( contradiction )
+     {
+       return false;
+     }
+     if( hidden != 0 )
+     {
+       MaskT slots = 0;
+       for( const int i : CandidatesT( static_cast<MaskT>( hidden )))
+       {
+         slots |= sets[i];
+       }
+       for( const int slot : CandidatesT( slots ))
+       {
+         if( !eliminate( worklist, unit_cells[slot], others, Technique::SOLVE_FOR_SUBSETS ))
+         {
+           return false;
          }
        }
      }
+     return true;
+   }
+
+   // find subset
+   // a depth-first search for k of the sets whose union has only k members, for k from 2 to largest,
+   // that the test passes. A branch is given up as soon as its union has more than largest members,
+   // as adding sets only adds members.
+   //
+   //@param  the sets, how many, the largest subset to look for, the sets chosen so far as bits, how
+   //        many, their union, the first set that may be added, the test, which is given the chosen sets
+   //        and their union, set if k of the sets have fewer than k members between them
+   //@return the chosen sets of the subset found as bits, 0 if there isn't one
+   template< typename TestT >
+   static unsigned int
+   find_subset( const MaskT* sets, int count, int largest, unsigned int chosen, int size, MaskT combined, int next,
+                const TestT& test, bool& contradiction )
+   {
+     for( int i = next; i < count; ++i )
+     {
+       const MaskT grown = combined | sets[i];
+       const int members = CellT::popcount( grown );
+       if( members > largest )
+       {
+         continue;
+       }
+       const unsigned int subset = chosen | ( 1u << i );
+       if( size + 1 >= 2 )
+       {
+         if( members < size + 1 )
+         {
+           contradiction = true;
+           return 0;
+         }
+         if( members == size + 1 && test( subset, grown ))
+         {
+           return subset;
+         }
+       }
+       if( size + 1 < largest )
+       {
+         const unsigned int found = find_subset( sets, count, largest, subset, size + 1, grown, i + 1, test, contradiction );
+         if( found != 0 || contradiction )
+         {
+           return found;
+         }
+       }
+     }
+     return 0;
    }
 
 
    // solve by guessing
-   // if a cell that is unsolved has two candidates only, it will eliminate one to solve that cell,
-   // if it is correct it keeps this grid, if it is false it will choose the other option and keep going from there
+   // a depth-first search for the solution. The unsolved cell with the fewest candidates is guessed,
+   // each guess is propagated on a copy of the grid and the search backtracks when a guess
+   // leads to a contradiction. When it returns true this grid holds the solution. When the deadline
+   // expires first it returns false, and the grid may be left part way through a guess.
+   //
+   //@param timings and stats to add to, if any, techniques to use, deadline, if any
+   //@return false if the grid has no solution, or the deadline expired
+   bool
+   solve_by_guessing( Timings* timings = 0, Stats* stats = 0, Technique::SetT techniques = Technique::DEFAULT,
+                      const Deadline* deadline = 0 )
+   {
+     Timings::Scope scope( timings, Technique::SOLVE_BY_GUESSING );
+     Worklist worklist( timings, stats, techniques, deadline );
+     return initialise( worklist ) && propagate( worklist ) && search( worklist );
+   }
+
+   // count solutions
+   // the same search as solve_by_guessing(), carried on past the first solution until limit solutions
+   // have been found or there are no more, so a limit of 2 tells a unique puzzle from one with several.
+   // The search stops the moment it reaches the limit, or the deadline expires. This grid is left holding
+   // the first solution found.
+   //
+   //@param most solutions to look for, timings and stats to add to, if any, techniques to use, deadline,
+   //       if any
+   //@return the number of solutions found, no more than limit
+   int
+   count_solutions( int limit, Timings* timings = 0, Stats* stats = 0, Technique::SetT techniques = Technique::DEFAULT,
+                    const Deadline* deadline = 0 )
+   {
+     Timings::Scope scope( timings, Technique::SOLVE_BY_GUESSING );
+     Worklist worklist( timings, stats, techniques, deadline );
+     if( limit <= 0 || !initialise( worklist ) || !propagate( worklist ))
+     {
+       return 0;
+     }
+     int  count = 0;
+     BasicGrid first;
+     BasicGrid search_grid( *this );
+     search_grid.count_search( worklist, limit, count, first );
+     if( count > 0 )
+     {
+       *this = first;
+     }
+     return count;
+   }
+
+   // get fewest candidates cell
+   // the index of the unsolved cell with the fewest candidates, minimum remaining values
    //
    //@param nothing
-   //@return nothing
+   //@return the cell's index, or -1 if every cell is solved
+   int
+   get_fewest_candidates_cell() const
+   {
+     int fewest_index = -1;
+     std::size_t fewest = SIZE_GRID + 1;
+     for( int cell_index = 0; cell_index < NUM_CELLS; ++cell_index )
+     {
+       const std::size_t size = m_cells[cell_index].size();
+       if( size > 1 && size < fewest )
+       {
+         fewest_index = cell_index;
+         fewest       = size;
+         if( fewest == 2 )
+         {
+           break;
+         }
+       }
+     }
+     return fewest_index;
+   }
+
+   // search
+   // expects a fully propagated grid, one with no contradiction found. Each level of the search, and
+   // the copy of the grid it guesses on, is kept in a stack on the heap sized once for the whole search,
+   // rather than on the call stack, as a 25x25 board can nest hundreds of levels of 5KB each. The last
+   // candidate at each level is guessed on its parent's grid, as nothing needs that afterwards.
+   //
+   //@param worklist whose timings, stats and techniques each guess uses
+   //@return false if no guess leads to a solution, or the deadline expired
    bool
-   solve_by_guessing()
+   search( const Worklist& parent )
    {
-     for ( const auto row : boost::irange( 0, SIZE_GRID ))
+     Timings* timings = parent.timings();
+     Stats*   stats   = parent.stats();
+     const int guess_index = get_fewest_candidates_cell();
+     if( guess_index < 0 )
+     {
+       return true;
+     }
+
+     const Deadline* deadline = parent.deadline();
+     SearchStack stack( *this, guess_index );
+     for( ;; )
      {
-       for ( const auto col : boost::irange( 0, SIZE_GRID ))
+       Level& level = stack.levels.back();
+       if( level.next == typename CandidatesT::const_iterator() )
        {
-         if( m_cells[row][col]->get_candidates().size() == 2 )
+         // every guess failed, so did the guess that led to this level
+         if( !stack.pop() )
          {
-           Grid temp_grid1( *this );
-           Grid temp_grid2( *this );
-           bool solved = false;
-           int first_guess = *m_cells[row][col]->get_candidates().begin();
-           *(temp_grid1.m_cells[row][col]) = first_guess;
-           bool solved1 = temp_grid1.solve();
-           if( solved1 )
-           {
-             *(this->m_cells[row][col]) = first_guess;
-             this->solve();
-             solved = true;
-             return true;
-           }
-           else
+           *this = stack.grids.front();
+           return false;
+         }
+         if( stats )
+         {
+           ++stats->backtracks;
+         }
+         continue;
+       }
+       if( deadline && deadline->expired() )
+       {
+         // every level returns false, failing the guess that led to it
+         if( stats )
+         {
+           stats->backtracks += static_cast<Stats::CountT>( stack.levels.size() - 1 );
+         }
+         *this = stack.grids.front();
+         return false;
+       }
+       const int value = *level.next++;
+       Worklist worklist( timings, stats, parent.techniques(), deadline );
+       if( stats )
+       {
+         ++stats->guesses;
+         if( level.next != typename CandidatesT::const_iterator() )
+         {
+           ++stats->grid_copies;
+         }
+       }
+       BasicGrid& guess_grid = stack.guess_on( level );
+       if( guess_grid.assign( worklist, level.index, value, Technique::SOLVE_BY_GUESSING ) && guess_grid.propagate( worklist ))
+       {
+         const int index = guess_grid.get_fewest_candidates_cell();
+         if( index < 0 )
+         {
+           *this = guess_grid;
+           return true;
+         }
+         stack.push( index );
+         continue;
+       }
+       if( stats )
+       {
+         ++stats->backtracks;
+       }
+       stack.drop_guess( level );
+     }
+   }
+
+   // count search
+   // search(), counting the solutions instead of stopping at the first
+   //
+   //@param worklist whose timings, stats and techniques each guess uses, most solutions to look for,
+   //       solutions found so far, the first solution found
+   //@return nothing
+   void
+   count_search( const Worklist& parent, int limit, int& count, BasicGrid& first )
+   {
+     Timings* timings = parent.timings();
+     Stats*   stats   = parent.stats();
+     const int guess_index = get_fewest_candidates_cell();
+     if( guess_index < 0 )
+     {
+       if( count++ == 0 )
+       {
+         first = *this;
+       }
+       return;
+     }
+
+     const Deadline* deadline = parent.deadline();
+     SearchStack stack( *this, guess_index );
+     for( ;; )
+     {
+       Level& level = stack.levels.back();
+       if( level.next == typename CandidatesT::const_iterator() || count >= limit )
+       {
+         // this level is finished, and so is the guess that led to it
+         if( !stack.pop() )
+         {
+           return;
+         }
+         if( stats && count == stack.levels.back().found )
+         {
+           ++stats->backtracks;
+         }
+         continue;
+       }
+       if( deadline && deadline->expired() )
+       {
+         // every level returns, finishing the guess that led to it
+         for( std::size_t i = 0; stats && i + 1 < stack.levels.size(); ++i )
+         {
+           if( count == stack.levels[i].found )
            {
-             temp_grid2.m_cells[row][col]->remove_candidate( first_guess );
-             bool solved2 = temp_grid2.solve();
-             if( solved2 )
-             {
-               *(this->m_cells[row][col]) = *(temp_grid2.m_cells[row][col]->get_candidates().begin());
-               this->solve();
-               solved = true;
-               return true;
-             }
+             ++stats->backtracks;
            }
          }
+         return;
+       }
+       const int value = *level.next++;
+       level.found = count;
+       Worklist worklist( timings, stats, parent.techniques(), deadline );
+       if( stats )
+       {
+         ++stats->guesses;
+         if( level.next != typename CandidatesT::const_iterator() )
+         {
+           ++stats->grid_copies;
+         }
+       }
+       BasicGrid& guess_grid = stack.guess_on( level );
+       if( guess_grid.assign( worklist, level.index, value, Technique::SOLVE_BY_GUESSING ) && guess_grid.propagate( worklist ))
+       {
+         const int index = guess_grid.get_fewest_candidates_cell();
+         if( index >= 0 )
+         {
+           stack.push( index );
+           continue;
+         }
+         if( count++ == 0 )
+         {
+           first = guess_grid;
+         }
+       }
+       if( stats && count == level.found )
+       {
+         ++stats->backtracks;
        }
+       stack.drop_guess( level );
      }
-     return false;
    }
     
  
- bool 
- reducing_candidates_and_not_solved( int no_of_candidates_before, int no_of_candidates_after )
- {
-   return no_of_candidates_before != no_of_candidates_after && no_of_candidates_after != ( NUM_CELLS );
- }
-
+  // solved
+  // true when every cell has exactly one candidate
   bool
-  solve()
+  solved() const
   {
-    int no_of_candidates_before =  0;
-    int no_of_candidates_after  = -1;
-    initialise();
-    // while stil reducing candidates and not solved
-    while( reducing_candidates_and_not_solved( no_of_candidates_before, no_of_candidates_after ))
+    for( const CellT& analysed_cell : m_cells )
     {
-      no_of_candidates_before = no_of_candidates_after;
-      no_of_candidates_after  = 0;
-      
-
-      remove_candidates();
-      solve_for_row();
-      solve_for_col();
-      solve_for_subgrid();
-      solve_for_naked_pairs();
-      
-      for ( const auto row : boost::irange( 0, SIZE_GRID ))
+      if( !analysed_cell.solved() )
       {
-        for ( const auto col : boost::irange( 0, SIZE_GRID ))
-        {
-          no_of_candidates_after += m_cells[row][col]->get_candidates().size();  
-        }
+        return false;
       }
     }
-    
-    return (no_of_candidates_after == ( NUM_CELLS ));
+    return true;
+  }
+
+  // solve
+  // solves as much of the grid as logic alone allows
+  //
+  //@param timings and stats to add to, if any, techniques to use, deadline, if any
+  //@return true if the grid was solved
+  bool
+  solve( Timings* timings = 0, Stats* stats = 0, Technique::SetT techniques = Technique::DEFAULT, const Deadline* deadline = 0 )
+  {
+    Worklist worklist( timings, stats, techniques, deadline );
+    return initialise( worklist ) && propagate( worklist ) && solved();
+  }
+
+  // set given
+  // fills in a cell from one character of a puzzle: a value from 1 to SIZE_GRID is a given,
+  // anything else ('0', '.') leaves the cell empty
+  //
+  //@param index of the cell, character from the puzzle
+  //@return nothing
+  void
+  set_given( int cell_index, char value )
+  {
+    const int digit = value_of( value );
+    if( digit > 0 )
+    {
+      m_cells[cell_index] = digit;
+    }
+  }
+
+  // value of
+  // the value one character of a puzzle stands for. Values up to 9 are their digits and larger ones
+  // are letters, 'A' (or 'a') for 10 and so on, so a 16x16 board runs to 'G' and a 25x25 one to 'P'.
+  // Cells are printed the same way, with CellT::char_of()
+  //
+  //@param character from the puzzle
+  //@return the value, 0 if the character isn't one of this board's values
+  static int
+  value_of( char value )
+  {
+    int digit = 0;
+    if( value >= '1' && value <= '9' )
+    {
+      digit = value - '0';
+    }
+    else if( value >= 'A' && value <= 'Z' )
+    {
+      digit = value - 'A' + 10;
+    }
+    else if( value >= 'a' && value <= 'z' )
+    {
+      digit = value - 'a' + 10;
+    }
+    return digit <= SIZE_GRID ? digit : 0;
   }
 
   static int 
@@ -726,23 +1090,103 @@ public:
 
 private:
 
-  typedef std::map< Cell*, std::pair<int, int>> MapCellToRowColT;
-
-  MapCellToRowColT                                m_map_cell_to_row_col;
-  std::vector<std::vector<std::shared_ptr<Cell>>> m_cells;
+  // Level
+  // one level of search(): the cell it guesses, the candidates it has still to try, the solutions that
+  // count_search() had found when it made its latest guess, and which of the stack's grids it guesses on
+  struct Level
+  {
+    int index;
+    typename CandidatesT::const_iterator next;
+    int found;
+    std::size_t grid;
+  };
 
-  void 
-  set_cell_value( int row, int col, int value )
+  // SearchStack
+  // the levels of a search and the grids they guess on, starting from a copy of the grid searched. There
+  // can't be more levels than the grid has unsolved cells, as each guess solves one, or more grids than
+  // one more than that, so both are reserved once and never move.
+  struct SearchStack
   {
-    *( m_cells[row][col] ) = value;
-  }
+    std::vector<Level>     levels;
+    std::vector<BasicGrid> grids;
+
+    SearchStack( const BasicGrid& top, int index )
+    {
+      const std::size_t depth = static_cast<std::size_t>( std::count_if( top.m_cells.begin(), top.m_cells.end(),
+                                                                        []( const CellT& cell ) { return !cell.solved(); } ));
+      levels.reserve( depth );
+      grids.reserve( depth + 1 );
+      grids.push_back( top );
+      push( index );
+    }
+
+    // push
+    // a level that guesses on the latest grid
+    void
+    push( int index )
+    {
+      const Level level = { index, grids.back().m_cells[index].get_candidates().begin(), 0, grids.size() - 1 };
+      levels.push_back( level );
+    }
+
+    // pop
+    // the latest level, and its grid unless its parent guesses on that too
+    //
+    //@return false if that was the top level
+    bool
+    pop()
+    {
+      const std::size_t grid = levels.back().grid;
+      levels.pop_back();
+      if( levels.empty() )
+      {
+        return false;
+      }
+      if( levels.back().grid != grid )
+      {
+        grids.pop_back();
+      }
+      return true;
+    }
+
+    // guess on
+    // the grid for a level's guess that has just been taken, a copy of the level's grid unless it was
+    // the last candidate
+    BasicGrid&
+    guess_on( const Level& level )
+    {
+      if( level.next != typename CandidatesT::const_iterator() )
+      {
+        grids.push_back( grids[level.grid] );
+      }
+      return grids.back();
+    }
+
+    // drop guess
+    // the grid of a guess that led nowhere, if it was a copy
+    void
+    drop_guess( const Level& level )
+    {
+      if( grids.size() - 1 != level.grid )
+      {
+        grids.pop_back();
+      }
+    }
+  };
+
+  // a single contiguous block, so copying a grid is a plain memcpy
+  CellArrayT m_cells;
 
-  friend std::istream& operator>>( std::istream& in, Grid& grid );
-  friend std::ostream& operator<<( std::ostream& out, Grid& grid );
 };// end class
 
+typedef BasicGrid<3> Grid;
+
+static_assert( std::is_trivially_copyable<Cell>::value, "Cell must stay trivially copyable" );
+static_assert( std::is_trivially_copyable<Grid>::value, "Grid must stay trivially copyable" );
+
 
- std::istream& operator>>( std::istream& in, Grid& grid )
+ template <int SUBGRID>
+ inline std::istream& operator>>( std::istream& in, BasicGrid<SUBGRID>& grid )
  {
    if ( !in.eof() )
    {
@@ -750,18 +1194,13 @@ private:
      // CONVERT text into number
      // set cell value
      // USE THE LINE NUMBER AND CHARACTER NUMBER FOR ROW AND COLUMN
-     for( int row = 0; row < Grid::get_size(); ++row)
+     for( int row = 0; row < grid.get_size(); ++row)
      {
        std::string line;
        getline( in, line );
-       for( int col = 0; col < Grid::get_size(); ++col )
+       for( int col = 0; col < grid.get_size(); ++col )
        {
-         char temp_char = line[col];
-         int value;
-         std::strstream str;
-         str << temp_char;
-         str >> value;
-         grid.set_cell_value( row, col, value );
+         grid.set_given( grid.index( row, col ), col < static_cast<int>( line.size() ) ? line[col] : '0' );
        }
      }
    }
@@ -769,13 +1208,14 @@ private:
    return in;
  }
 
-std::ostream& operator<<( std::ostream& out, Grid& grid )
+template <int SUBGRID>
+inline std::ostream& operator<<( std::ostream& out, BasicGrid<SUBGRID>& grid )
 {
-  for( int row = 0; row < 9; ++row )
+  for( int row = 0; row < grid.get_size(); ++row )
     {
-      for( int col = 0; col < 9; ++col )
+      for( int col = 0; col < grid.get_size(); ++col )
       {
-        out << "[ " << *(grid.m_cells[row][col]) << " ]";
+        out << "[ " << grid.cell( row, col ) << " ]";
       }
       out << std::endl;
     }
@@ -0,0 +1,281 @@
+#pragma once
+#include <cstddef>
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// MappedFile
+// a read-only memory mapping of a file, so that it can be parsed straight from the page cache without
+// copying it through a stream buffer. The file is mapped a window of up to WINDOW_SIZE bytes at a time,
+// since a 32-bit process has no room to map a file of a few gigabytes whole; begin() and end() are the
+// bytes of the current window and advance() moves on to the next one. An empty or missing file maps to
+// no bytes; open() says which, and a window that can't be mapped ends the input and makes open() false.
+
+class MappedFile
+{
+public:
+  static const std::size_t WINDOW_SIZE = 64 << 20;
+
+#if defined( _WIN32 )
+  explicit MappedFile( const char* path ) : m_data( 0 ), m_size( 0 ), m_open( false ), m_view( 0 ), m_view_size( 0 ), m_offset( 0 ),
+                                            m_file_size( 0 ), m_mapping( 0 )
+  {
+    map( CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0 ));
+  }
+
+  explicit MappedFile( const wchar_t* path ) : m_data( 0 ), m_size( 0 ), m_open( false ), m_view( 0 ), m_view_size( 0 ), m_offset( 0 ),
+                                               m_file_size( 0 ), m_mapping( 0 )
+  {
+    map( CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0 ));
+  }
+
+  ~MappedFile()
+  {
+    unmap();
+    if ( m_mapping )
+    {
+      CloseHandle( m_mapping );
+    }
+  }
+#else
+  explicit MappedFile( const char* path ) : m_data( 0 ), m_size( 0 ), m_open( false ), m_view( 0 ), m_view_size( 0 ), m_offset( 0 ),
+                                            m_file_size( 0 ), m_fd( ::open( path, O_RDONLY ))
+  {
+    if ( m_fd < 0 )
+    {
+      return;
+    }
+    m_open = true;
+    struct stat info;
+    if ( fstat( m_fd, &info ) == 0 && info.st_size > 0 )
+    {
+      m_file_size = static_cast<unsigned long long>( info.st_size );
+      m_open      = map_window( 0 );
+    }
+  }
+
+  ~MappedFile()
+  {
+    unmap();
+    if ( m_fd >= 0 )
+    {
+      ::close( m_fd );
+    }
+  }
+#endif
+
+  bool
+  open() const
+  {
+    return m_open;
+  }
+
+  const char*
+  begin() const
+  {
+    return m_data;
+  }
+
+  const char*
+  end() const
+  {
+    return m_data + m_size;
+  }
+
+  std::size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  // last
+  // whether the current window runs to the end of the file
+  //
+  //@param nothing
+  //@return true for the last window
+  bool
+  last() const
+  {
+    return m_offset + m_size == m_file_size;
+  }
+
+  // advance
+  // maps the next window, starting from a point in the current one, so that a record the current window
+  // cut short is whole in the next
+  //
+  //@param first byte of the next window, between begin() and end()
+  //@return false at the end of the file, or if the window couldn't be mapped
+  bool
+  advance( const char* from )
+  {
+    const unsigned long long offset = m_offset + static_cast<std::size_t>( from - m_data );
+    if ( offset >= m_file_size )
+    {
+      return false;
+    }
+    m_open = map_window( offset );
+    return m_open;
+  }
+
+private:
+  MappedFile( const MappedFile& );
+  MappedFile& operator=( const MappedFile& );
+
+#if defined( _WIN32 )
+  void
+  map( HANDLE file )
+  {
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+      return;
+    }
+    m_open = true;
+    LARGE_INTEGER size;
+    if ( GetFileSizeEx( file, &size ) && size.QuadPart > 0 )
+    {
+      m_file_size = static_cast<unsigned long long>( size.QuadPart );
+      m_mapping   = CreateFileMapping( file, 0, PAGE_READONLY, 0, 0, 0 );
+      m_open      = m_mapping != 0 && map_window( 0 );
+    }
+    CloseHandle( file );
+  }
+
+  static unsigned long long
+  granularity()
+  {
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return info.dwAllocationGranularity;
+  }
+#else
+  static unsigned long long
+  granularity()
+  {
+    return static_cast<unsigned long long>( sysconf( _SC_PAGESIZE ));
+  }
+#endif
+
+  // map window
+  // maps up to WINDOW_SIZE bytes from a view that starts at or before the offset, where the system
+  // allows views to start
+  //
+  //@param offset in the file of the window's first byte
+  //@return false if the view couldn't be mapped
+  bool
+  map_window( unsigned long long offset )
+  {
+    unmap();
+    const unsigned long long start = offset - ( offset % granularity() );
+    const unsigned long long rest  = m_file_size - start;
+    const std::size_t length = rest < WINDOW_SIZE ? static_cast<std::size_t>( rest ) : WINDOW_SIZE;
+#if defined( _WIN32 )
+    void* view = MapViewOfFile( m_mapping, FILE_MAP_READ, static_cast<DWORD>( start >> 32 ), static_cast<DWORD>( start ), length );
+    if ( view == 0 )
+    {
+      return false;
+    }
+#else
+    void* view = mmap( 0, length, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off_t>( start ));
+    if ( view == MAP_FAILED )
+    {
+      return false;
+    }
+    madvise( view, length, MADV_SEQUENTIAL );
+#endif
+    m_view      = static_cast<const char*>( view );
+    m_view_size = length;
+    m_offset    = offset;
+    m_data      = m_view + static_cast<std::size_t>( offset - start );
+    m_size      = length - static_cast<std::size_t>( offset - start );
+    return true;
+  }
+
+  void
+  unmap()
+  {
+    if ( m_view )
+    {
+#if defined( _WIN32 )
+      UnmapViewOfFile( m_view );
+#else
+      munmap( const_cast<char*>( m_view ), m_view_size );
+#endif
+    }
+    m_view      = 0;
+    m_view_size = 0;
+    m_data      = 0;
+    m_size      = 0;
+  }
+
+  const char*        m_data;
+  std::size_t        m_size;
+  bool               m_open;
+  const char*        m_view;
+  std::size_t        m_view_size;
+  // the offsets in the file of m_data and of its end
+  unsigned long long m_offset;
+  unsigned long long m_file_size;
+#if defined( _WIN32 )
+  HANDLE             m_mapping;
+#else
+  int                m_fd;
+#endif
+};
+
+// MappedReader
+// reads records out of a MappedFile a window at a time with a reader that parses a block of bytes.
+// ReaderT( first, last, final ) reads from the block, and unless it's the final one, leaves a record that
+// runs into the block's end for the next; next( record ) reads a record, and rest() is the first byte it
+// hasn't used, where the next window starts.
+
+template <typename ReaderT>
+class MappedReader
+{
+public:
+  explicit MappedReader( MappedFile& file ) : m_file( file ), m_reader( file.begin(), file.end(), file.last() )
+  {
+  }
+
+  // next
+  // reads the next record, mapping the next window when the current one runs out
+  //
+  //@param record to fill in
+  //@return false when there are no more records
+  template <typename RecordT>
+  bool
+  next( RecordT& record )
+  {
+    while ( !m_reader.next( record ))
+    {
+      if ( m_file.last() )
+      {
+        return false;
+      }
+      const char* rest = m_reader.rest();
+      if ( rest == m_file.begin() )
+      {
+        // one record fills the whole window, so read it as far as the window goes
+        m_reader = ReaderT( m_file.begin(), m_file.end(), true );
+        continue;
+      }
+      if ( !m_file.advance( rest ))
+      {
+        return false;
+      }
+      m_reader = ReaderT( m_file.begin(), m_file.end(), m_file.last() );
+    }
+    return true;
+  }
+
+private:
+  MappedFile& m_file;
+  ReaderT     m_reader;
+};
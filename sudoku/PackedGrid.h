@@ -0,0 +1,119 @@
+#pragma once
+#include "Grid.h"
+#include <cstddef>
+#include <ostream>
+
+// PackedGrid
+// the packed binary format for bulk files of puzzles and solutions: a nibble per cell, row by row, two
+// cells to a byte with the first in the low nibble, holding the cell's value, or 0 for a cell that is
+// empty or isn't solved. A grid takes BYTES bytes, 41 for 81 cells, and the spare high nibble of the
+// last byte is 0. Records follow one another with no header or separator, so files can be split and
+// joined anywhere on a record boundary, and every record can be found from its number.
+
+class PackedGrid
+{
+public:
+  static const std::size_t BYTES = ( Grid::NUM_CELLS + 1 ) / 2;
+
+  static_assert( Grid::SIZE_GRID < 16, "a value has to fit in a nibble" );
+
+  // pack
+  // the solved cells of a grid, the givens of a puzzle or the values of a solution
+  //
+  //@param the grid, BYTES bytes to fill in
+  //@return nothing
+  static void
+  pack( const Grid& grid, unsigned char* record )
+  {
+    for ( std::size_t byte = 0; byte < BYTES; ++byte )
+    {
+      record[byte] = 0;
+    }
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const Cell& analysed_cell = grid.get_cells()[cell_index];
+      if ( analysed_cell.solved() )
+      {
+        record[cell_index / 2] |= static_cast<unsigned char>( analysed_cell.get_solution() << ( 4 * ( cell_index % 2 )));
+      }
+    }
+  }
+
+  // unpack
+  // a grid with the record's values as givens. A nibble that isn't a value leaves its cell empty.
+  //
+  //@param BYTES bytes of record, grid to fill in
+  //@return nothing
+  static void
+  unpack( const unsigned char* record, Grid& grid )
+  {
+    grid = Grid();
+    for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+    {
+      const int value = ( record[cell_index / 2] >> ( 4 * ( cell_index % 2 ))) & 0xf;
+      if ( value <= Grid::SIZE_GRID )
+      {
+        grid.set_given( cell_index, static_cast<char>( '0' + value ));
+      }
+    }
+  }
+
+  // write
+  // a grid's record to a stream, which has to be open in binary mode
+  //
+  //@param the stream, the grid
+  //@return nothing
+  static void
+  write( std::ostream& out, const Grid& grid )
+  {
+    unsigned char record[BYTES];
+    pack( grid, record );
+    out.write( reinterpret_cast<const char*>( record ), BYTES );
+  }
+};
+
+// PackedReader
+// reads packed grids straight out of a block of bytes, normally a MappedFile, in the same way as
+// PuzzleReader reads text. A short record at the end of the input is ignored, or left for the next block
+// when the block isn't the final one.
+
+class PackedReader
+{
+public:
+  // records are all the same size, so a short one is simply not read whether or not the block is final
+  PackedReader( const char* first, const char* last, bool = true ) : m_pos( first ), m_end( last )
+  {
+  }
+
+  // rest
+  // the first byte that hasn't been read
+  //
+  //@param nothing
+  //@return the position in the block
+  const char*
+  rest() const
+  {
+    return m_pos;
+  }
+
+  // next
+  // reads the next grid from the input into a freshly constructed grid
+  //
+  //@param grid to fill in
+  //@return false when there are no more grids
+  bool
+  next( Grid& grid )
+  {
+    if ( static_cast<std::size_t>( m_end - m_pos ) < PackedGrid::BYTES )
+    {
+      return false;
+    }
+    PackedGrid::unpack( reinterpret_cast<const unsigned char*>( m_pos ), grid );
+    m_pos += PackedGrid::BYTES;
+    return true;
+  }
+
+private:
+  const char* m_pos;
+  const char* m_end;
+};
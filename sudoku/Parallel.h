@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// parallel for
+// calls f( i ) for every i in [0, count) on the given number of threads. Indices are handed out in
+// chunks from a shared counter, so a thread that gets easy work just comes back for more, and the
+// calling thread works alongside the others. f must be safe to call concurrently for different i.
+//
+//@param count of indices, number of threads, function to call, indices taken at a time
+//@return nothing
+template <typename F>
+void
+parallel_for( std::size_t count, int threads, F f, std::size_t chunk = 64 )
+{
+  if ( threads <= 1 || count <= chunk )
+  {
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+      f( i );
+    }
+    return;
+  }
+
+  std::atomic<std::size_t> next( 0 );
+  auto worker = [&]()
+  {
+    for ( ;; )
+    {
+      const std::size_t first = next.fetch_add( chunk );
+      if ( first >= count )
+      {
+        return;
+      }
+      const std::size_t last = std::min( first + chunk, count );
+      for ( std::size_t i = first; i < last; ++i )
+      {
+        f( i );
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for ( int i = 1; i < threads; ++i )
+  {
+    pool.emplace_back( worker );
+  }
+  worker();
+  for ( auto& thread : pool )
+  {
+    thread.join();
+  }
+}
+
+// the number of threads to use when asked for 0, one per core
+inline int
+default_thread_count()
+{
+  const unsigned int cores = std::thread::hardware_concurrency();
+  return cores == 0 ? 1 : static_cast<int>( cores );
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "Grid.h"
+#include <cstddef>
+#include <cstring>
+
+// PuzzleReader
+// parses grids straight out of a block of bytes, normally a MappedFile, without copying lines into a
+// stream or a string. Two layouts are understood, and may be mixed in one file:
+//
+//   the Project Euler layout, a "Grid NN" header line followed by SIZE_GRID lines of SIZE_GRID digits
+//   one puzzle per line, NUM_CELLS characters with '0' or '.' for an empty cell
+//
+// Any other line (blank lines, comments) is skipped. The reader is a template on the grid, for boards
+// of other sizes, whose values past 9 are letters; PuzzleReader reads the usual 9x9 grids. Unless the
+// block is the final one, a grid that runs into its end is left for the next block, from rest().
+
+template <typename GridT>
+class BasicPuzzleReader
+{
+public:
+  BasicPuzzleReader( const char* first, const char* last, bool final = true ) : m_pos( first ), m_end( last ), m_final( final )
+  {
+  }
+
+  // rest
+  // the first byte that hasn't been read
+  //
+  //@param nothing
+  //@return the position in the block
+  const char*
+  rest() const
+  {
+    return m_pos;
+  }
+
+  // next
+  // reads the next grid from the input into a freshly constructed grid
+  //
+  //@param grid to fill in
+  //@return false when there are no more grids
+  bool
+  next( GridT& grid )
+  {
+    const char* line;
+    std::size_t length;
+    for ( const char* start = m_pos; next_line( line, length ); start = m_pos )
+    {
+      if ( length >= 4 && std::memcmp( line, "Grid", 4 ) == 0 )
+      {
+        grid = GridT();
+        for ( int row = 0; row < GridT::SIZE_GRID; ++row )
+        {
+          if ( !next_line( line, length ))
+          {
+            m_pos = m_final ? m_pos : start;
+            return false;
+          }
+          const std::size_t cols = length < GridT::SIZE_GRID ? length : GridT::SIZE_GRID;
+          for ( std::size_t col = 0; col < cols; ++col )
+          {
+            grid.set_given( GridT::index( row, static_cast<int>( col )), line[col] );
+          }
+        }
+        return true;
+      }
+      if ( length >= GridT::NUM_CELLS && is_puzzle_line( line ))
+      {
+        grid = GridT();
+        for ( int cell_index = 0; cell_index < GridT::NUM_CELLS; ++cell_index )
+        {
+          grid.set_given( cell_index, line[cell_index] );
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  // next line
+  // the next line of input without its line ending
+  //
+  //@param start of the line, its length
+  //@return false at the end of the input, or at a line that runs into the end of a block that isn't final
+  bool
+  next_line( const char*& line, std::size_t& length )
+  {
+    if ( m_pos >= m_end )
+    {
+      return false;
+    }
+    line = m_pos;
+    const char* eol = static_cast<const char*>( std::memchr( m_pos, '\n', m_end - m_pos ));
+    if ( eol == 0 )
+    {
+      if ( !m_final )
+      {
+        return false;
+      }
+      eol = m_end;
+    }
+    m_pos  = eol < m_end ? eol + 1 : m_end;
+    length = eol - line;
+    if ( length > 0 && line[length - 1] == '\r' )
+    {
+      --length;
+    }
+    return true;
+  }
+
+  static bool
+  is_puzzle_line( const char* line )
+  {
+    for ( int i = 0; i < GridT::NUM_CELLS; ++i )
+    {
+      const char c = line[i];
+      if ( c != '.' && c != '0' && GridT::value_of( c ) == 0 )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const char* m_pos;
+  const char* m_end;
+  bool        m_final;
+};
+
+typedef BasicPuzzleReader<Grid> PuzzleReader;
@@ -0,0 +1,454 @@
+#pragma once
+#include "Solver.h"
+#include "PuzzleReader.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined( _WIN32 )
+// winsock2.h has to come before windows.h, so this header goes before MappedFile.h
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment( lib, "ws2_32.lib" )
+#else
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// The solver as a long-running service. Requests and replies are framed as lines, so that a caller can
+// send many requests down one pipe or connection without waiting, and match the replies, which come
+// back in the order they are finished, by the id it gave each request:
+//
+//   request   <id> <puzzle>                        the puzzle as NUM_CELLS characters, '0' or '.' for empty
+//   reply     <id> <status> <grid> <microseconds>  status solved, unsolved, timed_out or not_started, and
+//                                                  the grid as NUM_CELLS digits, '0' where it isn't solved
+//   error     <id> error <message>                 for a request that can't be read
+//
+// The id is any word without spaces, up to MAX_ID characters; a longer one is answered with "error id too
+// long". Blank lines are ignored.
+
+// ReplySink
+// where the replies to one caller's requests go, one whole line at a time. It counts the requests that
+// haven't been answered, so the caller's stream isn't closed under a worker that is still solving.
+
+class ReplySink
+{
+public:
+  ReplySink() : m_pending( 0 )
+  {
+  }
+
+  virtual ~ReplySink()
+  {
+  }
+
+  // expect
+  // counts a request that will be answered
+  void
+  expect()
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    ++m_pending;
+  }
+
+  // deliver
+  // writes a reply to an expected request, from whichever thread solved it
+  //
+  //@param the line, with its line ending
+  //@return nothing
+  void
+  deliver( const std::string& line )
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    write( line.data(), line.size() );
+    if ( --m_pending == 0 )
+    {
+      m_drained.notify_all();
+    }
+  }
+
+  // send
+  // writes a line that doesn't answer an expected request, an error
+  void
+  send( const std::string& line )
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    write( line.data(), line.size() );
+  }
+
+  // drain
+  // waits until every expected request has been answered
+  void
+  drain()
+  {
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_drained.wait( lock, [this]() { return m_pending == 0; } );
+  }
+
+protected:
+  // write
+  // puts bytes on the caller's stream, called under the sink's lock
+  virtual void
+  write( const char* data, std::size_t size ) = 0;
+
+private:
+  std::mutex              m_mutex;
+  std::condition_variable m_drained;
+  int                     m_pending;
+};
+
+// SolveServer
+// a pool of warm worker threads that solve requests from any number of callers as they come in. The
+// threads are started, and the solver's tables and kernels set up, once when the server is made, and
+// each thread keeps its own result and reply line, so a request costs no more than its solve.
+
+class SolveServer
+{
+public:
+  static constexpr std::size_t MAX_ID = 64;
+
+  SolveServer( const SolveOptions& options, int threads ) : m_solver( options ), m_stopping( false )
+  {
+    // the first solve sets up what every later one shares, so do it now rather than in a request
+    m_solver.solve( Grid() );
+    for ( int i = 0; i < ( threads > 0 ? threads : 1 ); ++i )
+    {
+      m_workers.emplace_back( [this]() { work(); } );
+    }
+  }
+
+  ~SolveServer()
+  {
+    {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      m_stopping = true;
+    }
+    m_ready.notify_all();
+    for ( std::thread& worker : m_workers )
+    {
+      worker.join();
+    }
+  }
+
+  // submit
+  // reads one request line and queues it, or answers it with an error straight away
+  //
+  //@param the line, without its line ending, where its reply goes
+  //@return nothing
+  void
+  submit( const std::string& line, ReplySink& sink )
+  {
+    Request request;
+    request.sink = &sink;
+    const std::size_t id_start = line.find_first_not_of( " \t" );
+    if ( id_start == std::string::npos )
+    {
+      return;
+    }
+    const std::size_t id_end = std::min( line.find_first_of( " \t", id_start ), line.size() );
+    request.id.assign( line, id_start, id_end - id_start );
+    if ( request.id.size() > MAX_ID )
+    {
+      sink.send( request.id + " error id too long\n" );
+      return;
+    }
+    const std::size_t puzzle_start = std::min( line.find_first_not_of( " \t", id_end ), line.size() );
+    PuzzleReader reader( line.data() + puzzle_start, line.data() + line.size() );
+    if ( !reader.next( request.puzzle ))
+    {
+      sink.send( request.id + " error expected " + std::to_string( Grid::NUM_CELLS ) + " cells\n" );
+      return;
+    }
+
+    sink.expect();
+    {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      m_queue.push_back( request );
+    }
+    m_ready.notify_one();
+  }
+
+  // status name
+  // how a reply names a status
+  static const char*
+  status_name( SolveResult::Status status )
+  {
+    switch ( status )
+    {
+    case SolveResult::SOLVED:
+      return "solved";
+    case SolveResult::UNSOLVED:
+      return "unsolved";
+    case SolveResult::TIMED_OUT:
+      return "timed_out";
+    default:
+      return "not_started";
+    }
+  }
+
+private:
+  struct Request
+  {
+    std::string id;
+    Grid        puzzle;
+    ReplySink*  sink;
+  };
+
+  // work
+  // a worker's loop, solving requests until the server stops
+  void
+  work()
+  {
+    SolveResult result;
+    std::string line;
+    line.reserve( MAX_ID + Grid::NUM_CELLS + 32 );
+    for ( ;; )
+    {
+      Request request;
+      {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_ready.wait( lock, [this]() { return m_stopping || !m_queue.empty(); } );
+        if ( m_queue.empty() )
+        {
+          return;
+        }
+        request = m_queue.front();
+        m_queue.pop_front();
+      }
+      result = m_solver.solve( request.puzzle );
+      line.assign( request.id );
+      line += ' ';
+      line += status_name( result.status );
+      line += ' ';
+      line += result.solution();
+      line += ' ';
+      line += std::to_string( std::chrono::duration_cast<std::chrono::microseconds>( result.time ).count() );
+      line += '\n';
+      request.sink->deliver( line );
+    }
+  }
+
+  const Solver             m_solver;
+  std::mutex               m_mutex;
+  std::condition_variable  m_ready;
+  std::deque<Request>      m_queue;
+  bool                     m_stopping;
+  std::vector<std::thread> m_workers;
+};
+
+// FileSink
+// replies to a caller on a stdio stream, normally standard output, flushed after every line so that a
+// caller on the other end of a pipe sees each reply as soon as it's ready
+
+class FileSink : public ReplySink
+{
+public:
+  explicit FileSink( std::FILE* file ) : m_file( file )
+  {
+  }
+
+  ~FileSink()
+  {
+    drain();
+  }
+
+protected:
+  void
+  write( const char* data, std::size_t size )
+  {
+    std::fwrite( data, 1, size, m_file );
+    std::fflush( m_file );
+  }
+
+private:
+  std::FILE* m_file;
+};
+
+// serve file
+// serves the requests on a stdio stream, normally standard input, until it ends, and waits for the
+// last replies
+//
+//@param server, the requests, where the replies go
+//@return nothing
+inline void
+serve_file( SolveServer& server, std::FILE* in, std::FILE* out )
+{
+  FileSink sink( out );
+  std::string line;
+  char buffer[4096];
+  while ( std::fgets( buffer, sizeof( buffer ), in ))
+  {
+    line += buffer;
+    if ( line.back() != '\n' && !std::feof( in ))
+    {
+      continue;
+    }
+    while ( !line.empty() && ( line.back() == '\n' || line.back() == '\r' ))
+    {
+      line.pop_back();
+    }
+    server.submit( line, sink );
+    line.clear();
+  }
+  if ( !line.empty() )
+  {
+    server.submit( line, sink );
+  }
+}
+
+// SocketSink
+// replies to a caller on its connection. A caller that closes its end early mustn't take the server down
+// with SIGPIPE, so sends are made without it, and once one fails the rest of its replies are dropped.
+
+class SocketSink : public ReplySink
+{
+public:
+#if defined( _WIN32 )
+  typedef SOCKET SocketT;
+#else
+  typedef int SocketT;
+#endif
+
+  explicit SocketSink( SocketT socket ) : m_socket( socket ), m_gone( false )
+  {
+#if !defined( _WIN32 ) && !defined( MSG_NOSIGNAL ) && defined( SO_NOSIGPIPE )
+    const int no_sigpipe = 1;
+    setsockopt( m_socket, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof( no_sigpipe ));
+#endif
+  }
+
+  ~SocketSink()
+  {
+    drain();
+  }
+
+protected:
+  void
+  write( const char* data, std::size_t size )
+  {
+#if defined( MSG_NOSIGNAL )
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    while ( size > 0 && !m_gone )
+    {
+      const int sent = static_cast<int>( ::send( m_socket, data, static_cast<int>( size ), flags ));
+      if ( sent <= 0 )
+      {
+#if !defined( _WIN32 )
+        if ( sent < 0 && errno == EINTR )
+        {
+          continue;
+        }
+#endif
+        // EPIPE or ECONNRESET: the caller has gone, so there's no one to give this or later replies to
+        m_gone = true;
+        return;
+      }
+      data += sent;
+      size -= static_cast<std::size_t>( sent );
+    }
+  }
+
+private:
+  SocketT m_socket;
+  bool    m_gone;  // written only under the sink's lock, like everything write() touches
+};
+
+// serve socket
+// listens on a TCP port of the loopback interface and serves every connection on its own thread,
+// sharing the server's workers, until the process ends. Each connection is served like a stream, and
+// is closed once the caller has closed its end and the last reply has gone.
+//
+//@param server, port
+//@return false if the port can't be listened on
+inline bool
+serve_socket( SolveServer& server, int port )
+{
+  typedef SocketSink::SocketT SocketT;
+#if defined( _WIN32 )
+  WSADATA wsa_data;
+  if ( WSAStartup( MAKEWORD( 2, 2 ), &wsa_data ) != 0 )
+  {
+    return false;
+  }
+  const SocketT invalid = INVALID_SOCKET;
+#else
+  const SocketT invalid = -1;
+#endif
+  auto close_socket = []( SocketT socket )
+  {
+#if defined( _WIN32 )
+    closesocket( socket );
+#else
+    ::close( socket );
+#endif
+  };
+
+  const SocketT listener = ::socket( AF_INET, SOCK_STREAM, 0 );
+  if ( listener == invalid )
+  {
+    return false;
+  }
+  const int reuse = 1;
+  setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>( &reuse ), sizeof( reuse ));
+  sockaddr_in address = sockaddr_in();
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  address.sin_port        = htons( static_cast<unsigned short>( port ));
+  if ( ::bind( listener, reinterpret_cast<const sockaddr*>( &address ), sizeof( address )) != 0 || ::listen( listener, 16 ) != 0 )
+  {
+    close_socket( listener );
+    return false;
+  }
+
+  for ( ;; )
+  {
+    const SocketT connection = ::accept( listener, 0, 0 );
+    if ( connection == invalid )
+    {
+      continue;
+    }
+    std::thread( [&server, connection, close_socket]()
+    {
+      {
+        SocketSink sink( connection );
+        std::string pending;
+        char buffer[4096];
+        int received;
+        while (( received = static_cast<int>( ::recv( connection, buffer, sizeof( buffer ), 0 ))) > 0 )
+        {
+          pending.append( buffer, static_cast<std::size_t>( received ));
+          std::size_t start = 0;
+          for ( std::size_t eol; ( eol = pending.find( '\n', start )) != std::string::npos; start = eol + 1 )
+          {
+            std::size_t end = eol;
+            if ( end > start && pending[end - 1] == '\r' )
+            {
+              --end;
+            }
+            server.submit( pending.substr( start, end - start ), sink );
+          }
+          pending.erase( 0, start );
+        }
+        if ( !pending.empty() )
+        {
+          server.submit( pending, sink );
+        }
+      }
+      close_socket( connection );
+    }).detach();
+  }
+}
@@ -0,0 +1,145 @@
+#include "Solver.h"
+#include "BatchSweep.h"
+#include "Parallel.h"
+#include "PuzzleReader.h"
+
+std::string
+SolveResult::solution() const
+{
+  std::string ret( Grid::NUM_CELLS, '0' );
+  for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+  {
+    const Cell& analysed_cell = grid.get_cells()[cell_index];
+    if ( analysed_cell.solved() )
+    {
+      ret[cell_index] = static_cast<char>( '0' + analysed_cell.get_solution() );
+    }
+  }
+  return ret;
+}
+
+std::vector<Grid>
+Solver::parse( const char* first, const char* last )
+{
+  std::vector<Grid> grids;
+  PuzzleReader reader( first, last );
+  Grid grid;
+  while ( reader.next( grid ))
+  {
+    grids.push_back( grid );
+  }
+  return grids;
+}
+
+SolveResult
+Solver::solve( const Grid& puzzle ) const
+{
+  SolveResult result;
+  result.grid = puzzle;
+  Timings* timings = m_options.instrument ? &result.timings : 0;
+  Stats*   stats   = m_options.instrument ? &result.stats : 0;
+  const Technique::SetT techniques = m_options.techniques;
+
+  const Clock::time_point start = Clock::now();
+  const Deadline limit = Deadline::after( m_options.solve_time_limit, m_options.cancel );
+  const Deadline* deadline = limit.limited() ? &limit : 0;
+  bool solved = result.grid.solve( timings, stats, techniques, deadline );
+  const Grid logic = result.grid;
+  // a solution is good however long it took, but a count is only finished if it reached the limit
+  bool finished = solved;
+  if ( m_options.solution_limit > 0 )
+  {
+    // logic only makes deductions that every solution shares, so a grid it solves has just the one
+    result.solutions = solved ? 1 : result.grid.count_solutions( m_options.solution_limit, timings, stats, techniques, deadline );
+    finished = solved || result.solutions >= m_options.solution_limit;
+    solved   = result.solutions > 0;
+  }
+  else if ( !solved && ( techniques & Technique::bit( Technique::SOLVE_BY_GUESSING )) != 0 )
+  {
+    solved   = result.grid.solve_by_guessing( timings, stats, techniques, deadline );
+    finished = solved;
+  }
+  result.time   = Clock::now() - start;
+  result.status = solved ? SolveResult::SOLVED : SolveResult::UNSOLVED;
+  // only a search that stopped on the deadline timed out, not one that ran to its end after the time
+  if ( deadline && !finished && deadline->gave_up() )
+  {
+    result.status = SolveResult::TIMED_OUT;
+    result.grid   = logic;
+  }
+  return result;
+}
+
+std::vector<SolveResult>
+Solver::solve_all( const std::vector<Grid>& puzzles ) const
+{
+  std::vector<SolveResult> results( puzzles.size() );
+  const int threads = m_options.threads > 0 ? m_options.threads : default_thread_count();
+  const bool budgeted = m_options.time_budget > Clock::duration::zero();
+  const Clock::time_point deadline = Clock::now() + m_options.time_budget;
+
+  auto stopped = [&]()
+  {
+    return ( budgeted && Clock::now() >= deadline ) || ( m_options.cancel && m_options.cancel->load( std::memory_order_relaxed ));
+  };
+
+  if ( !m_options.batch || m_options.instrument || m_options.solution_limit > 0 || !BatchSweep::available() )
+  {
+    parallel_for( puzzles.size(), threads, [&]( std::size_t i )
+    {
+      if ( stopped() )
+      {
+        results[i].grid = puzzles[i];
+        return;
+      }
+      results[i] = solve( puzzles[i] );
+    });
+    return results;
+  }
+
+  // each block of puzzles is swept together, and shares the time that took
+  const std::size_t lanes  = BatchSweep::LANES;
+  const std::size_t blocks = ( puzzles.size() + lanes - 1 ) / lanes;
+  parallel_for( blocks, threads, [&]( std::size_t block )
+  {
+    const std::size_t first = block * lanes;
+    const std::size_t last  = std::min( first + lanes, puzzles.size() );
+    if ( stopped() )
+    {
+      for ( std::size_t i = first; i < last; ++i )
+      {
+        results[i].grid = puzzles[i];
+      }
+      return;
+    }
+
+    const Clock::time_point start = Clock::now();
+    BatchSweep batch;
+    for ( std::size_t i = first; i < last; ++i )
+    {
+      batch.load( static_cast<int>( i - first ), puzzles[i] );
+    }
+    const unsigned int swept = batch.sweep();
+    const Clock::duration share = ( Clock::now() - start ) / static_cast<Clock::rep>( last - first );
+
+    for ( std::size_t i = first; i < last; ++i )
+    {
+      const int lane = static_cast<int>( i - first );
+      if (( swept >> lane ) & 1u )
+      {
+        results[i].grid   = batch.grid( lane );
+        results[i].status = SolveResult::SOLVED;
+        results[i].time   = share;
+      }
+      else if ( stopped() )
+      {
+        results[i].grid = puzzles[i];
+      }
+      else
+      {
+        results[i] = solve( puzzles[i] );
+      }
+    }
+  }, 4 );
+  return results;
+}
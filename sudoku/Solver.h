@@ -0,0 +1,170 @@
+#pragma once
+#include "Deadline.h"
+#include "Grid.h"
+#include "Stats.h"
+#include "Technique.h"
+#include "Timings.h"
+#include "Trace.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// SolveOptions
+// how a Solver goes about it: the threads a batch of puzzles is shared between, how long a batch and
+// each puzzle may take, what cancels them, which of the optional techniques may be used and whether
+// a batch is swept several puzzles at a time
+
+struct SolveOptions
+{
+  // threads for a batch, 0 for one per core
+  int threads;
+  // puzzles that haven't been started once a batch has taken this long are given back as NOT_STARTED,
+  // zero for no limit
+  Clock::duration time_budget;
+  // a puzzle that takes longer than this gives up and is given back as TIMED_OUT, zero for no limit
+  Clock::duration solve_time_limit;
+  // raising this flag makes every solve give up as TIMED_OUT at its next check, and a batch give back
+  // the puzzles it hasn't started as NOT_STARTED. The flag has to outlive the solves, 0 for none
+  const std::atomic<bool>* cancel;
+  // Technique::bit()s of the techniques to use. Naked pairs, subsets and guessing can be left out;
+  // propagation is built on the rest, so they are always used. The default leaves out the subsets
+  Technique::SetT techniques;
+  // whether each result's stats and timings are filled in
+  bool instrument;
+  // with a limit, solutions are counted up to it instead of stopping at the first, 2 to check that a
+  // puzzle's solution is unique. Counting always guesses. 0 for no counting
+  int solution_limit;
+  // whether solve_all() first sweeps the puzzles BatchSweep::LANES at a time, so that the ones the sweep
+  // alone solves need nothing more. It isn't used with instrument or a solution limit, as the batch
+  // keeps no stats and counts nothing, or on a cpu without a vector kernel for it
+  bool batch;
+
+  SolveOptions()
+    : threads( 1 ), time_budget( Clock::duration::zero() ), solve_time_limit( Clock::duration::zero() ), cancel( 0 ),
+      techniques( Technique::DEFAULT ), instrument( false ), solution_limit( 0 ), batch( true )
+  {
+  }
+};
+
+// SolveResult
+// what became of one puzzle
+
+struct SolveResult
+{
+  enum Status
+  {
+    // every cell is solved
+    SOLVED,
+    // the puzzle has no solution, or without guessing the logic ran out
+    UNSOLVED,
+    // the batch's time budget ran out first, or it was cancelled
+    NOT_STARTED,
+    // the puzzle's time limit ran out, or it was cancelled, before it was finished
+    TIMED_OUT
+  };
+
+  Status status;
+  // the grid as far as it was solved, the puzzle itself if it was never started. A puzzle that timed
+  // out has what the logic found before any guessing
+  Grid grid;
+  // filled in if the options asked for them
+  Stats   stats;
+  Timings timings;
+  // how long the solve took
+  Clock::duration time;
+  // with a solution limit, the solutions found, no more than the limit
+  int solutions;
+
+  SolveResult() : status( NOT_STARTED ), grid(), stats(), timings(), time( Clock::duration::zero() ), solutions( 0 )
+  {
+  }
+
+  // unique
+  // true if counting found exactly one solution, which with a limit of 2 or more means the puzzle has one
+  //
+  //@param nothing
+  //@return whether the solution is unique
+  bool
+  unique() const
+  {
+    return solutions == 1;
+  }
+
+  // finished
+  // whether the puzzle was solved, or found to have no solution, rather than left unfinished
+  //
+  //@param nothing
+  //@return whether the result is the puzzle's for good
+  bool
+  finished() const
+  {
+    return status == SOLVED || status == UNSOLVED;
+  }
+
+  // solution
+  // the grid as NUM_CELLS characters, row by row, with '0' for a cell that isn't solved
+  //
+  //@param nothing
+  //@return the solution
+  std::string
+  solution() const;
+};
+
+// Solver
+// the solver for programs that embed it. Puzzles are parsed from a buffer in either layout that
+// PuzzleReader understands, and solved one at a time or in batches shared between threads. A Solver
+// holds nothing but its options, so one can be used from any number of threads at once.
+
+class Solver
+{
+public:
+  explicit Solver( const SolveOptions& options = SolveOptions() ) : m_options( options )
+  {
+  }
+
+  const SolveOptions&
+  options() const
+  {
+    return m_options;
+  }
+
+  // parse
+  // every puzzle in a buffer
+  //
+  //@param the buffer
+  //@return the puzzles, in order
+  static std::vector<Grid>
+  parse( const char* first, const char* last );
+
+  // solve
+  // one puzzle, logic first and then guessing if that's allowed. The time budget doesn't apply.
+  //
+  //@param the puzzle
+  //@return the result
+  SolveResult
+  solve( const Grid& puzzle ) const;
+
+  // solve all
+  // a batch of puzzles on the options' threads, swept BatchSweep::LANES at a time if the options
+  // allow, with the puzzles the sweep doesn't solve then solved one at a time
+  //
+  //@param the puzzles
+  //@return a result for each puzzle, in order
+  std::vector<SolveResult>
+  solve_all( const std::vector<Grid>& puzzles ) const;
+
+  // solve all
+  // every puzzle in a buffer
+  //
+  //@param the buffer
+  //@return a result for each puzzle, in order
+  std::vector<SolveResult>
+  solve_all( const char* first, const char* last ) const
+  {
+    return solve_all( parse( first, last ));
+  }
+
+private:
+  SolveOptions m_options;
+};
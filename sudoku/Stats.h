@@ -0,0 +1,76 @@
+#pragma once
+#include <ostream>
+#include "Technique.h"
+
+// Stats
+// how hard a grid was for the solver: how often it propagated, how many candidates each technique
+// eliminated and how much guessing it took. Pass one to Grid::solve() and Grid::solve_by_guessing()
+// to have it filled in; the counts for a batch are summed with +=.
+
+struct Stats
+{
+  typedef unsigned long long CountT;
+
+  // calls to Grid::propagate(), one for the logic on its own and then one for each guess
+  CountT propagations;
+  // units searched for hidden singles and naked pairs
+  CountT units_searched;
+  // candidates eliminated by each technique, a guess counts for the candidates it eliminated. The sweep's
+  // are counted as remove candidates and hidden singles, so eliminated[SWEEP] stays 0
+  CountT eliminated[Technique::NUM_TECHNIQUES];
+  // values tried by solve_by_guessing()
+  CountT guesses;
+  // guesses that led to a contradiction
+  CountT backtracks;
+  // copies of the grid taken to guess on
+  CountT grid_copies;
+
+  Stats() : propagations( 0 ), units_searched( 0 ), eliminated(), guesses( 0 ), backtracks( 0 ), grid_copies( 0 )
+  {
+  }
+
+  CountT
+  total_eliminated() const
+  {
+    CountT total = 0;
+    for ( int i = 0; i < Technique::NUM_TECHNIQUES; ++i )
+    {
+      total += eliminated[i];
+    }
+    return total;
+  }
+
+  Stats&
+  operator+=( const Stats& rhs )
+  {
+    propagations   += rhs.propagations;
+    units_searched += rhs.units_searched;
+    for ( int i = 0; i < Technique::NUM_TECHNIQUES; ++i )
+    {
+      eliminated[i] += rhs.eliminated[i];
+    }
+    guesses     += rhs.guesses;
+    backtracks  += rhs.backtracks;
+    grid_copies += rhs.grid_copies;
+    return *this;
+  }
+};
+
+inline std::ostream& operator<<( std::ostream& out, const Stats& stats )
+{
+  out << "propagations: " << stats.propagations
+      << ", units searched: " << stats.units_searched
+      << ", eliminated:";
+  for ( int i = 0; i < Technique::NUM_TECHNIQUES; ++i )
+  {
+    // neither has eliminations of its own
+    if ( i != Technique::INITIALISE && i != Technique::SWEEP )
+    {
+      out << " " << Technique::name( static_cast<Technique::Type>( i )) << " " << stats.eliminated[i];
+    }
+  }
+  out << ", guesses: "     << stats.guesses
+      << ", backtracks: "  << stats.backtracks
+      << ", grid copies: " << stats.grid_copies;
+  return out;
+}
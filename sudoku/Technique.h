@@ -0,0 +1,59 @@
+#pragma once
+
+// Technique
+// the parts of the solver that timings and stats are kept for
+
+struct Technique
+{
+  enum Type
+  {
+    INITIALISE,
+    SWEEP,
+    REMOVE_CANDIDATES,
+    SOLVE_FOR_ROW,
+    SOLVE_FOR_COL,
+    SOLVE_FOR_SUBGRID,
+    SOLVE_FOR_NAKED_PAIRS,
+    SOLVE_FOR_SUBSETS,
+    SOLVE_BY_GUESSING,
+    NUM_TECHNIQUES
+  };
+
+  // a set of techniques, one bit for each
+  typedef unsigned int SetT;
+  static const SetT ALL = ( 1u << NUM_TECHNIQUES ) - 1;
+  // the techniques used unless others are asked for: all but the subsets, which on the whole cost more
+  // to look for than the guesses they save
+  static const SetT DEFAULT = ALL & ~( 1u << SOLVE_FOR_SUBSETS );
+
+  static SetT
+  bit( Type technique )
+  {
+    return 1u << technique;
+  }
+
+  static const char*
+  name( Type technique )
+  {
+    static const char* const names[NUM_TECHNIQUES] =
+    {
+      "initialise",
+      "sweep",
+      "remove_candidates",
+      "solve_for_row",
+      "solve_for_col",
+      "solve_for_subgrid",
+      "solve_for_naked_pairs",
+      "solve_for_subsets",
+      "solve_by_guessing"
+    };
+    return names[technique];
+  }
+
+  // the hidden singles technique for a unit, as the units are numbered rows, then columns, then subgrids
+  static Type
+  for_unit( int unit, int size_grid )
+  {
+    return static_cast<Type>( SOLVE_FOR_ROW + ( unit / size_grid ));
+  }
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "Technique.h"
+#include "Trace.h"
+
+// Timings
+// the time spent in each technique of the solver. Pass one to Grid::solve() to have it filled in;
+// without one the solver doesn't read the clock at all. Times for a batch are summed with +=.
+
+class Timings
+{
+public:
+  typedef Clock ClockT;
+
+  typedef Technique::Type TechniqueT;
+
+  // Scope
+  // adds the time from construction to destruction to a technique, if there are timings to add to
+  class Scope
+  {
+  public:
+    Scope( Timings* timings, TechniqueT technique )
+      : m_timings( timings ), m_technique( technique ), m_start( timings ? ClockT::now() : ClockT::time_point() )
+    {
+    }
+
+    ~Scope()
+    {
+      if ( m_timings )
+      {
+        m_timings->add( m_technique, ClockT::now() - m_start );
+      }
+    }
+
+  private:
+    Scope( const Scope& );
+    Scope& operator=( const Scope& );
+
+    Timings*           m_timings;
+    TechniqueT         m_technique;
+    ClockT::time_point m_start;
+  };
+
+  Timings() : m_times()
+  {
+  }
+
+  void
+  add( TechniqueT technique, ClockT::duration time )
+  {
+    m_times[technique] += time;
+  }
+
+  ClockT::duration
+  get( TechniqueT technique ) const
+  {
+    return m_times[technique];
+  }
+
+  Timings&
+  operator+=( const Timings& rhs )
+  {
+    for ( int i = 0; i < Technique::NUM_TECHNIQUES; ++i )
+    {
+      m_times[i] += rhs.m_times[i];
+    }
+    return *this;
+  }
+
+private:
+  ClockT::duration m_times[Technique::NUM_TECHNIQUES];
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#if defined( TRACE_USE_RDTSC ) && ( defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ ))
+#define TRACE_RDTSC 1
+#if defined( _MSC_VER )
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Clock
+// the clock that both solvers time themselves with. It is a std::chrono clock counting nanoseconds
+// from std::chrono::steady_clock, so it behaves the same on every platform. Building with
+// TRACE_USE_RDTSC reads the cpu's time stamp counter instead, which is cheaper to read, and converts
+// it with a rate measured against steady_clock the first time it's used; only do that on cpus with an
+// invariant tsc.
+
+class Clock
+{
+public:
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep            rep;
+  typedef duration::period         period;
+  typedef std::chrono::time_point<Clock> time_point;
+  static const bool is_steady = true;
+
+  static time_point
+  now()
+  {
+#if defined( TRACE_RDTSC )
+    // the rate first, so that calibrating on the first call isn't counted in the reading
+    const double rate = nanoseconds_per_tick();
+    return time_point( duration( static_cast<rep>( static_cast<double>( __rdtsc() ) * rate )));
+#else
+    return time_point( std::chrono::duration_cast<duration>( std::chrono::steady_clock::now().time_since_epoch() ));
+#endif
+  }
+
+private:
+#if defined( TRACE_RDTSC )
+  static double
+  nanoseconds_per_tick()
+  {
+    static const double rate = calibrate();
+    return rate;
+  }
+
+  static double
+  calibrate()
+  {
+    typedef std::chrono::steady_clock SteadyT;
+    const SteadyT::time_point start = SteadyT::now();
+    const unsigned long long  ticks = __rdtsc();
+    while ( SteadyT::now() - start < std::chrono::milliseconds( 10 ))
+    {
+    }
+    const double nanoseconds = static_cast<double>( std::chrono::duration_cast<duration>( SteadyT::now() - start ).count() );
+    return nanoseconds / static_cast<double>( __rdtsc() - ticks );
+  }
+#endif
+};
+
+// format time
+// a duration in the most readable of microseconds, milliseconds or seconds
+//
+//@param duration
+//@return the formatted time
+inline std::string
+format_time( Clock::duration time )
+{
+  const double seconds = std::chrono::duration<double>( time ).count();
+  std::ostringstream oss;
+
+  if ( seconds < 0.001 )
+  {
+    oss << seconds * 1000000.0 << " microseconds";
+  }
+  else if ( seconds < 1.0 )
+  {
+    oss << seconds * 1000.0 << " milliseconds";
+  }
+  else
+  {
+    oss << seconds << " seconds";
+  }
+
+  return oss.str();
+}
+
+// TraceBuffer
+// the last SIZE samples of where a solver has got to, each a label and the time it was recorded.
+// The samples live in a fixed array, so recording one is a clock read and two stores, and once the
+// buffer is full the oldest sample is overwritten. Samples are numbered oldest first.
+//
+// Only the nurikabe solver records into one, a sample as it starts each step of analysis, for its -t
+// report and the bench's count of hypotheticals. The sudoku solver's techniques are timed through the
+// Timings that Grid::solve() is given, which sum each technique's time rather than keep samples.
+
+template <std::size_t SIZE>
+class TraceBuffer
+{
+public:
+  struct Sample
+  {
+    const char*      label;
+    Clock::time_point time;
+  };
+
+  TraceBuffer() : m_samples(), m_next( 0 ), m_count( 0 ), m_wrapped( false )
+  {
+  }
+
+  // label must outlive the buffer, normally it's a string literal
+  void
+  record( const char* label )
+  {
+    Sample& sample = m_samples[m_next];
+    sample.label = label;
+    sample.time  = Clock::now();
+    m_next       = ( m_next + 1 ) % SIZE;
+    if ( m_count < SIZE )
+    {
+      ++m_count;
+    }
+    else
+    {
+      m_wrapped = true;
+    }
+  }
+
+  std::size_t
+  size() const
+  {
+    return m_count;
+  }
+
+  // true once samples have been overwritten
+  bool
+  wrapped() const
+  {
+    return m_wrapped;
+  }
+
+  const Sample&
+  operator[]( std::size_t i ) const
+  {
+    return m_samples[( m_next + SIZE - m_count + i ) % SIZE];
+  }
+
+  void
+  clear()
+  {
+    m_next    = 0;
+    m_count   = 0;
+    m_wrapped = false;
+  }
+
+private:
+  std::array<Sample, SIZE> m_samples;
+  std::size_t              m_next;
+  std::size_t              m_count;
+  bool                     m_wrapped;
+};
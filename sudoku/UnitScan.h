@@ -0,0 +1,246 @@
+#pragma once
+#include "Cell.h"
+#include "Units.h"
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define UNIT_SCAN_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#endif
+
+// the vector kernels are compiled for their instruction set on their own, so the rest of the program
+// still runs on a cpu without it
+#if defined( UNIT_SCAN_X86 ) && defined( __GNUC__ )
+#define UNIT_SCAN_TARGET( isa ) __attribute__(( target( isa )))
+#else
+#define UNIT_SCAN_TARGET( isa )
+#endif
+
+// UnitScan
+// what every unit of a grid holds, worked out for all the units at once: the values that are
+// candidates in one cell and in more than one, the values of the solved cells and any value that is
+// solved twice. The candidate masks are gathered unit by unit into one lane per unit, so each step of
+// the scan is the same few operations on every unit, done a vector at a time. The kernel is chosen
+// for the cpu the first time one is needed. The vector kernels work on 16-bit masks, so boards whose
+// masks are wider are always scanned by the scalar kernel.
+
+template <int SUBGRID>
+class UnitScan
+{
+public:
+  typedef BasicCell<SUBGRID>      CellT;
+  typedef typename CellT::MaskT   MaskT;
+  typedef Units<SUBGRID>          UnitsT;
+
+  // whether the vector kernels can be used for this board's masks
+  static const bool VECTOR_MASKS = sizeof( MaskT ) == sizeof( std::uint16_t );
+
+  enum Kernel
+  {
+    SCALAR,
+    SSE2,
+    AVX2
+  };
+
+  // one lane per unit, rounded up to whole AVX2 vectors; the spare lanes are always empty
+  static const int LANES = (( UnitsT::NUM_UNITS + 15 ) / 16 ) * 16;
+
+  // values that are a candidate of at least one and of at least two cells
+  alignas( 32 ) MaskT once[LANES];
+  alignas( 32 ) MaskT twice[LANES];
+  // values of the solved cells, and values solved in more than one of them
+  alignas( 32 ) MaskT placed[LANES];
+  alignas( 32 ) MaskT clashes[LANES];
+
+  UnitScan() : m_lanes()
+  {
+  }
+
+  // the values that only one cell of a unit can take
+  MaskT
+  singles( int unit ) const
+  {
+    return once[unit] & static_cast<MaskT>( ~twice[unit] );
+  }
+
+  // scan
+  // fills in the masks of every unit from the cells of a grid
+  //
+  //@param the grid's cells, the kernel to use
+  //@return nothing
+  void
+  scan( const CellT* cells, Kernel kernel = best_kernel() )
+  {
+    const UnitsT& units = UnitsT::get();
+    for ( int unit = 0; unit < UnitsT::NUM_UNITS; ++unit )
+    {
+      for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+      {
+        m_lanes[k][unit] = cells[units.unit_cells[unit][k]].get_mask();
+      }
+    }
+    switch ( VECTOR_MASKS ? kernel : SCALAR )
+    {
+#if defined( UNIT_SCAN_X86 )
+    case AVX2:
+      scan_avx2();
+      break;
+    case SSE2:
+      scan_sse2();
+      break;
+#endif
+    default:
+      scan_scalar();
+      break;
+    }
+  }
+
+  // best kernel
+  // the widest kernel this cpu can run on this board's masks
+  static Kernel
+  best_kernel()
+  {
+    static const Kernel kernel = !VECTOR_MASKS ? SCALAR : ( cpu_has_avx2() ? AVX2 : ( cpu_has_sse2() ? SSE2 : SCALAR ));
+    return kernel;
+  }
+
+  static const char*
+  kernel_name( Kernel kernel )
+  {
+    return kernel == AVX2 ? "avx2" : ( kernel == SSE2 ? "sse2" : "scalar" );
+  }
+
+private:
+  void
+  scan_scalar()
+  {
+    for ( int lane = 0; lane < LANES; ++lane )
+    {
+      MaskT o = 0;
+      MaskT t = 0;
+      MaskT p = 0;
+      MaskT c = 0;
+      for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+      {
+        const MaskT mask   = m_lanes[k][lane];
+        const MaskT solved = ( mask != 0 && ( mask & ( mask - 1 )) == 0 ) ? mask : 0;
+        t |= o & mask;
+        o |= mask;
+        c |= p & solved;
+        p |= solved;
+      }
+      once[lane]    = o;
+      twice[lane]   = t;
+      placed[lane]  = p;
+      clashes[lane] = c;
+    }
+  }
+
+#if defined( UNIT_SCAN_X86 )
+  UNIT_SCAN_TARGET( "sse2" ) void
+  scan_sse2()
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi16( 1 );
+    for ( int lane = 0; lane < LANES; lane += 8 )
+    {
+      __m128i o = zero;
+      __m128i t = zero;
+      __m128i p = zero;
+      __m128i c = zero;
+      for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+      {
+        const __m128i mask = _mm_load_si128( reinterpret_cast<const __m128i*>( &m_lanes[k][lane] ));
+        // a cell is solved when its mask has exactly one bit, mask & ( mask - 1 ) is 0 and mask isn't
+        const __m128i one_bit = _mm_andnot_si128( _mm_cmpeq_epi16( mask, zero ),
+                                                  _mm_cmpeq_epi16( _mm_and_si128( mask, _mm_sub_epi16( mask, one )), zero ));
+        const __m128i solved  = _mm_and_si128( mask, one_bit );
+        t = _mm_or_si128( t, _mm_and_si128( o, mask ));
+        o = _mm_or_si128( o, mask );
+        c = _mm_or_si128( c, _mm_and_si128( p, solved ));
+        p = _mm_or_si128( p, solved );
+      }
+      _mm_store_si128( reinterpret_cast<__m128i*>( &once[lane] ),    o );
+      _mm_store_si128( reinterpret_cast<__m128i*>( &twice[lane] ),   t );
+      _mm_store_si128( reinterpret_cast<__m128i*>( &placed[lane] ),  p );
+      _mm_store_si128( reinterpret_cast<__m128i*>( &clashes[lane] ), c );
+    }
+  }
+
+  UNIT_SCAN_TARGET( "avx2" ) void
+  scan_avx2()
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi16( 1 );
+    for ( int lane = 0; lane < LANES; lane += 16 )
+    {
+      __m256i o = zero;
+      __m256i t = zero;
+      __m256i p = zero;
+      __m256i c = zero;
+      for ( int k = 0; k < UnitsT::SIZE_GRID; ++k )
+      {
+        const __m256i mask    = _mm256_load_si256( reinterpret_cast<const __m256i*>( &m_lanes[k][lane] ));
+        const __m256i one_bit = _mm256_andnot_si256( _mm256_cmpeq_epi16( mask, zero ),
+                                                     _mm256_cmpeq_epi16( _mm256_and_si256( mask, _mm256_sub_epi16( mask, one )), zero ));
+        const __m256i solved  = _mm256_and_si256( mask, one_bit );
+        t = _mm256_or_si256( t, _mm256_and_si256( o, mask ));
+        o = _mm256_or_si256( o, mask );
+        c = _mm256_or_si256( c, _mm256_and_si256( p, solved ));
+        p = _mm256_or_si256( p, solved );
+      }
+      _mm256_store_si256( reinterpret_cast<__m256i*>( &once[lane] ),    o );
+      _mm256_store_si256( reinterpret_cast<__m256i*>( &twice[lane] ),   t );
+      _mm256_store_si256( reinterpret_cast<__m256i*>( &placed[lane] ),  p );
+      _mm256_store_si256( reinterpret_cast<__m256i*>( &clashes[lane] ), c );
+    }
+  }
+#endif
+
+  static bool
+  cpu_has_sse2()
+  {
+#if defined( _M_X64 ) || defined( __x86_64__ )
+    return true;
+#elif defined( UNIT_SCAN_X86 ) && defined( __GNUC__ )
+    return __builtin_cpu_supports( "sse2" ) != 0;
+#elif defined( UNIT_SCAN_X86 ) && defined( _MSC_VER )
+    int info[4];
+    __cpuid( info, 1 );
+    return ( info[3] & ( 1 << 26 )) != 0;
+#else
+    return false;
+#endif
+  }
+
+  static bool
+  cpu_has_avx2()
+  {
+#if defined( UNIT_SCAN_X86 ) && defined( __GNUC__ )
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+#elif defined( UNIT_SCAN_X86 ) && defined( _MSC_VER )
+    // the cpu has to have it and the os has to save the ymm registers
+    int info[4];
+    __cpuid( info, 0 );
+    if ( info[0] < 7 )
+    {
+      return false;
+    }
+    __cpuid( info, 1 );
+    const int osxsave_avx = ( 1 << 27 ) | ( 1 << 28 );
+    if (( info[2] & osxsave_avx ) != osxsave_avx || ( _xgetbv( 0 ) & 6 ) != 6 )
+    {
+      return false;
+    }
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 5 )) != 0;
+#else
+    return false;
+#endif
+  }
+
+  // the k-th cell of every unit, lane by lane
+  alignas( 32 ) MaskT m_lanes[UnitsT::SIZE_GRID][LANES];
+};
@@ -0,0 +1,224 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Units - the rows, columns and subgrids of a grid, and the peers of each cell, generated at compile
+// time from the subgrid size. Cells are referred to by index, row * SIZE_GRID + col.
+//
+// units 0 .. SIZE_GRID-1                 are the rows
+// units SIZE_GRID .. 2*SIZE_GRID-1       are the columns
+// units 2*SIZE_GRID .. 3*SIZE_GRID-1     are the subgrids, numbered left to right, top to bottom
+
+// PeerList
+// the peers of one cell, the cells that share a unit with it, in ascending order. It is a struct so that a
+// row's worth can be built as a constant of its own and copied whole.
+
+template <int SUBGRID>
+struct PeerList
+{
+  static const int SIZE_GRID = SUBGRID * SUBGRID;
+  // the rest of the row and column, plus the rest of the subgrid that isn't in either
+  static const int NUM_PEERS = ( 2 * ( SIZE_GRID - 1 )) + (( SUBGRID - 1 ) * ( SUBGRID - 1 ));
+
+  int cells[NUM_PEERS];
+
+  const int*
+  begin() const
+  {
+    return cells;
+  }
+
+  const int*
+  end() const
+  {
+    return cells + NUM_PEERS;
+  }
+};
+
+// RowPeers
+// the peer lists of the cells of one row. Above and below the row's band they're the rest of each cell's
+// column, and in the band the subgrid's cells in each of the other rows and the rest of the row itself.
+
+template <int SUBGRID>
+struct RowPeers
+{
+  static const int SIZE_GRID = PeerList<SUBGRID>::SIZE_GRID;
+
+  PeerList<SUBGRID> peers[SIZE_GRID];
+
+  explicit constexpr RowPeers( int row ) : peers()
+  {
+    const int band = row - ( row % SUBGRID );
+    for ( int col = 0; col < SIZE_GRID; ++col )
+    {
+      int* peer = peers[col].cells;
+      const int subgrid_col = col - ( col % SUBGRID );
+      for ( int r = 0; r < SIZE_GRID; ++r )
+      {
+        if ( r < band || r >= band + SUBGRID )
+        {
+          *peer++ = ( r * SIZE_GRID ) + col;
+        }
+        else if ( r != row )
+        {
+          for ( int c = subgrid_col; c < subgrid_col + SUBGRID; ++c )
+          {
+            *peer++ = ( r * SIZE_GRID ) + c;
+          }
+        }
+        else
+        {
+          for ( int c = 0; c < SIZE_GRID; ++c )
+          {
+            if ( c != col )
+            {
+              *peer++ = ( r * SIZE_GRID ) + c;
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+// each row's peer lists are a constant of their own, so that no one constexpr evaluation fills in the
+// whole peer table, which on a 25x25 board is 40,000 cells, over the compilers' default step limits
+template <int SUBGRID, int ROW>
+constexpr RowPeers<SUBGRID> row_peers = RowPeers<SUBGRID>( ROW );
+
+template <int SUBGRID>
+struct Units
+{
+  static const int SIZE_SUBGRID  = SUBGRID;
+  static const int SIZE_GRID     = SIZE_SUBGRID * SIZE_SUBGRID;
+  static const int NUM_CELLS     = SIZE_GRID * SIZE_GRID;
+  static const int NUM_UNITS     = 3 * SIZE_GRID;
+  static const int UNITS_PER_CELL = 3;
+  static const int NUM_PEERS     = PeerList<SUBGRID>::NUM_PEERS;
+
+  enum UnitKind
+  {
+    ROW,
+    COL,
+    SUBGRID_UNIT
+  };
+
+  // the cells of each unit, in ascending order
+  int unit_cells[NUM_UNITS][SIZE_GRID];
+  // the row, column and subgrid unit of each cell
+  int cell_units[NUM_CELLS][UNITS_PER_CELL];
+  // the cells that share a unit with each cell, in ascending order
+  PeerList<SUBGRID> peers[NUM_CELLS];
+
+  static constexpr int
+  row_unit( int index )
+  {
+    return index / SIZE_GRID;
+  }
+
+  static constexpr int
+  col_unit( int index )
+  {
+    return SIZE_GRID + ( index % SIZE_GRID );
+  }
+
+  static constexpr int
+  subgrid_unit( int index )
+  {
+    return ( 2 * SIZE_GRID ) + ((( index / SIZE_GRID ) / SIZE_SUBGRID ) * SIZE_SUBGRID ) + (( index % SIZE_GRID ) / SIZE_SUBGRID );
+  }
+
+  static constexpr bool
+  is_peer( int first, int second )
+  {
+    return first != second &&
+           ( row_unit( first ) == row_unit( second ) ||
+             col_unit( first ) == col_unit( second ) ||
+             subgrid_unit( first ) == subgrid_unit( second ));
+  }
+
+  constexpr Units() : unit_cells(), cell_units(), peers()
+  {
+    int unit_size[NUM_UNITS] = {};
+    for ( int index = 0; index < NUM_CELLS; ++index )
+    {
+      cell_units[index][ROW]          = row_unit( index );
+      cell_units[index][COL]          = col_unit( index );
+      cell_units[index][SUBGRID_UNIT] = subgrid_unit( index );
+      for ( int kind = 0; kind < UNITS_PER_CELL; ++kind )
+      {
+        const int unit = cell_units[index][kind];
+        unit_cells[unit][unit_size[unit]++] = index;
+      }
+    }
+
+    copy_peers( std::make_integer_sequence<int, SIZE_GRID>() );
+  }
+
+  // the tables for this subgrid size, built once by the compiler
+  static const Units&
+  get()
+  {
+    static constexpr Units units = Units();
+    return units;
+  }
+
+private:
+  template <int... ROWS>
+  constexpr void
+  copy_peers( std::integer_sequence<int, ROWS...> )
+  {
+    const RowPeers<SUBGRID>* const rows[] = { &row_peers<SUBGRID, ROWS>... };
+    for ( int index = 0; index < NUM_CELLS; ++index )
+    {
+      peers[index] = rows[index / SIZE_GRID]->peers[index % SIZE_GRID];
+    }
+  }
+};
+
+// UnitSet
+// a set of units as bits, in a single word up to 32 units (the 9x9 board's 27) and in 64-bit words
+// beyond that, for the worklist's queues
+
+template <int NUM_UNITS>
+class UnitSet
+{
+public:
+  UnitSet() : m_words()
+  {
+  }
+
+  bool
+  test( int unit ) const
+  {
+    return ( m_words[unit / WORD_BITS] & ( WordT( 1 ) << ( unit % WORD_BITS ))) != 0;
+  }
+
+  void
+  set( int unit )
+  {
+    m_words[unit / WORD_BITS] |= WordT( 1 ) << ( unit % WORD_BITS );
+  }
+
+  void
+  reset( int unit )
+  {
+    m_words[unit / WORD_BITS] &= ~( WordT( 1 ) << ( unit % WORD_BITS ));
+  }
+
+  void
+  clear()
+  {
+    for ( WordT& word : m_words )
+    {
+      word = 0;
+    }
+  }
+
+private:
+  typedef typename std::conditional<NUM_UNITS <= 32, std::uint32_t, std::uint64_t>::type WordT;
+  static const int WORD_BITS = 8 * sizeof( WordT );
+
+  WordT m_words[( NUM_UNITS + WORD_BITS - 1 ) / WORD_BITS];
+};
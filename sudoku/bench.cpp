@@ -0,0 +1,522 @@
+// bench.cpp : the regression benchmark for both solvers.
+//
+// Runs a fixed corpus through the sudoku solver and the nurikabe solver, on one thread pinned to one
+// cpu, and prints a line of results for each case, tab separated, after a header line that starts with
+// '#'. Every case is run a number of times to warm up, and then timed over a number of trials:
+//
+//   case  puzzles  solved  trials  median_us  min_us  max_us  allocations  bytes  peak_rss_kb
+//
+// A sudoku case solves its puzzles SUDOKU_PASSES times in a trial, as its corpus takes well under a
+// millisecond to solve once. allocations and bytes are what operator new was asked for during one
+// trial, and peak_rss_kb is the process's peak resident set so far, so it only grows from one case to
+// the next. The results are compared with a baseline in the same format, normally bench/baseline.txt,
+// and a case which solves fewer puzzles, or which allocates more, or more bytes, than the baseline's by
+// more than the tolerance, is a regression. The exit code is 1 if there are any, so the Bench target of
+// bench.vcxproj fails:
+//
+//   msbuild bench.vcxproj /p:Configuration=Release /t:Bench
+//
+// The corpus is the 50 grids of Project Euler's sudoku.txt, 17-clue puzzles in bench/hard17.txt and
+// the twelve puzzles of the nurikabe driver's table in bench/nurikabe.txt, relative to the directory
+// given with -d, this one by default. Only solved, allocations and bytes are the same on every machine, so
+// the checked-in baseline has zero for the timings and peak_rss_kb; after a deliberate change a new one is
+// the results written with -o, with those columns zeroed. Timings only compare with results from the same machine
+// and build, so they are compared only when -T gives a tolerance, against a baseline written there with
+// -o and given with -b, and a median slower than that baseline's by more than the tolerance is a
+// regression. A missing baseline is an error, unless -o is given to write the results that make one.
+
+#include "Solver.h"
+#include "Trace.h"
+#include "stl/nurikabe.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment( lib, "psapi.lib" )
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+  // everything operator new is asked for, by any thread, from the start of the process
+  std::atomic<unsigned long long> g_allocations( 0 );
+  std::atomic<unsigned long long> g_allocated_bytes( 0 );
+
+  void*
+  counted_allocation( std::size_t size )
+  {
+    g_allocations.fetch_add( 1, std::memory_order_relaxed );
+    g_allocated_bytes.fetch_add( size, std::memory_order_relaxed );
+    void* memory = std::malloc( size > 0 ? size : 1 );
+    if ( !memory )
+    {
+      throw std::bad_alloc();
+    }
+    return memory;
+  }
+}
+
+void*
+operator new( std::size_t size )
+{
+  return counted_allocation( size );
+}
+
+void*
+operator new[]( std::size_t size )
+{
+  return counted_allocation( size );
+}
+
+void
+operator delete( void* memory ) noexcept
+{
+  std::free( memory );
+}
+
+void
+operator delete[]( void* memory ) noexcept
+{
+  std::free( memory );
+}
+
+void
+operator delete( void* memory, std::size_t ) noexcept
+{
+  std::free( memory );
+}
+
+void
+operator delete[]( void* memory, std::size_t ) noexcept
+{
+  std::free( memory );
+}
+
+// Case
+// one thing to time: a run of part of the corpus, which says how many of its puzzles it solved
+
+struct Case
+{
+  std::string          name;
+  int                  puzzles;
+  std::function<int()> run;
+};
+
+// Result
+// a case's line of results
+
+struct Result
+{
+  std::string        name;
+  int                puzzles;
+  int                solved;
+  int                trials;
+  long long          median_us;
+  long long          min_us;
+  long long          max_us;
+  unsigned long long allocations;
+  unsigned long long bytes;
+  long long          peak_rss_kb;
+};
+
+// pin thread
+// keeps the calling thread on one cpu, so that the trials aren't moved around between cores
+//
+//@param the cpu
+//@return false if it can't be pinned
+bool
+pin_thread( int cpu )
+{
+#if defined( _WIN32 )
+  return SetThreadAffinityMask( GetCurrentThread(), static_cast<DWORD_PTR>( 1 ) << cpu ) != 0;
+#else
+  cpu_set_t cpus;
+  CPU_ZERO( &cpus );
+  CPU_SET( cpu, &cpus );
+  return pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) == 0;
+#endif
+}
+
+// peak rss kb
+// the most memory the process has had resident at once
+//
+//@param nothing
+//@return kilobytes
+long long
+peak_rss_kb()
+{
+#if defined( _WIN32 )
+  PROCESS_MEMORY_COUNTERS counters;
+  if ( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters )))
+  {
+    return 0;
+  }
+  return static_cast<long long>( counters.PeakWorkingSetSize / 1024 );
+#else
+  rusage usage;
+  getrusage( RUSAGE_SELF, &usage );
+  return static_cast<long long>( usage.ru_maxrss );
+#endif
+}
+
+// read file
+// a whole file, or nothing if it can't be read
+//
+//@param path, where the contents go
+//@return false if it can't be read
+bool
+read_file( const std::string& path, std::string& contents )
+{
+  std::ifstream file( path.c_str(), std::ios_base::in | std::ios_base::binary );
+  if ( !file )
+  {
+    return false;
+  }
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  contents = buffer.str();
+  return true;
+}
+
+// measure
+// runs a case warmups times, and then times it over trials
+//
+//@param the case, number of warm-up runs, number of timed trials
+//@return its results
+Result
+measure( const Case& bench_case, int warmups, int trials )
+{
+  using namespace std;
+
+  for ( int i = 0; i < warmups; ++i )
+  {
+    bench_case.run();
+  }
+
+  Result result = Result();
+  result.name    = bench_case.name;
+  result.puzzles = bench_case.puzzles;
+  result.trials  = trials;
+  vector<long long> times;
+  for ( int i = 0; i < trials; ++i )
+  {
+    const unsigned long long allocations = g_allocations.load( memory_order_relaxed );
+    const unsigned long long bytes       = g_allocated_bytes.load( memory_order_relaxed );
+    const Clock::time_point start = Clock::now();
+    result.solved = bench_case.run();
+    times.push_back( chrono::duration_cast<chrono::microseconds>( Clock::now() - start ).count() );
+    // the solvers are deterministic, so every trial after the warm-up allocates the same
+    result.allocations = g_allocations.load( memory_order_relaxed ) - allocations;
+    result.bytes       = g_allocated_bytes.load( memory_order_relaxed ) - bytes;
+  }
+  sort( times.begin(), times.end() );
+  result.median_us   = times[times.size() / 2];
+  result.min_us      = times.front();
+  result.max_us      = times.back();
+  result.peak_rss_kb = peak_rss_kb();
+  return result;
+}
+
+// write header
+// the line that names the columns of the results
+void
+write_header( std::ostream& out )
+{
+  out << "# case\tpuzzles\tsolved\ttrials\tmedian_us\tmin_us\tmax_us\tallocations\tbytes\tpeak_rss_kb" << std::endl;
+}
+
+// write result
+// a case's line of results
+void
+write_result( std::ostream& out, const Result& result )
+{
+  out << result.name << '\t' << result.puzzles << '\t' << result.solved << '\t' << result.trials << '\t'
+      << result.median_us << '\t' << result.min_us << '\t' << result.max_us << '\t'
+      << result.allocations << '\t' << result.bytes << '\t' << result.peak_rss_kb << std::endl;
+}
+
+// read results
+// the results in a file written by write_header() and write_result(), by case
+//
+//@param the file's contents
+//@return the results
+std::map<std::string, Result>
+read_results( const std::string& contents )
+{
+  std::map<std::string, Result> results;
+  std::istringstream lines( contents );
+  std::string line;
+  while ( std::getline( lines, line ))
+  {
+    if ( line.empty() || line[0] == '#' )
+    {
+      continue;
+    }
+    std::replace( line.begin(), line.end(), '\t', ' ' );
+    std::istringstream fields( line );
+    Result result = Result();
+    if ( fields >> result.name >> result.puzzles >> result.solved >> result.trials >> result.median_us
+                >> result.min_us >> result.max_us >> result.allocations >> result.bytes >> result.peak_rss_kb )
+    {
+      results[result.name] = result;
+    }
+  }
+  return results;
+}
+
+// compare
+// each result with the baseline's, on standard error
+//
+//@param the results, the baseline, the tolerance for allocations and for timings as fractions, the
+//       latter negative if timings aren't compared
+//@return the number of regressions
+int
+compare( const std::vector<Result>& results, const std::map<std::string, Result>& baseline, double tolerance, double time_tolerance )
+{
+  using namespace std;
+
+  int regressions = 0;
+  for ( const Result& result : results )
+  {
+    const auto found = baseline.find( result.name );
+    if ( found == baseline.end() )
+    {
+      cerr << result.name << ": not in the baseline" << endl;
+      continue;
+    }
+    const Result& base = found->second;
+    const double change = base.median_us > 0 ? 100.0 * ( result.median_us - base.median_us ) / base.median_us : 0.0;
+    // a baseline without timings can't say whether this is slower, and -T asked to know
+    const bool untimed = time_tolerance >= 0.0 && base.median_us == 0;
+    const bool slower  = time_tolerance >= 0.0 && result.median_us > base.median_us * ( 1.0 + time_tolerance );
+    // the nurikabe solver orders its regions by address, which moves a few allocations between runs
+    const bool more    = result.allocations > base.allocations * ( 1.0 + tolerance ) || result.bytes > base.bytes * ( 1.0 + tolerance );
+    const bool fewer   = result.solved < base.solved;
+
+    char change_text[32];
+    snprintf( change_text, sizeof( change_text ), "%+.1f%%", change );
+    cerr << result.name << ": " << result.median_us << " us against " << base.median_us << " us (" << change_text << "), "
+         << result.allocations << " allocations against " << base.allocations << ", "
+         << result.bytes << " bytes against " << base.bytes;
+    if ( untimed || slower || more || fewer )
+    {
+      cerr << ", REGRESSION:" << ( untimed ? " no baseline timing" : slower ? " slower" : "" ) << ( more ? " allocates more" : "" ) << ( fewer ? " solves fewer" : "" );
+      ++regressions;
+    }
+    cerr << endl;
+  }
+  return regressions;
+}
+
+int
+main( int argc, char* argv[] )
+{
+  using namespace std;
+
+  int trials = 3;
+  int warmups = 1;
+  int cpu = 0;
+  double tolerance = 0.1;
+  double time_tolerance = -1.0;
+  string directory = ".";
+  string baseline_name;
+  string output_name;
+  string filter;
+
+  int arg = 1;
+  for ( ; arg + 1 < argc && argv[arg][0] == '-'; arg += 2 )
+  {
+    if ( strcmp( argv[arg], "-n" ) == 0 )
+    {
+      trials = max( 1, atoi( argv[arg + 1] ));
+    }
+    else if ( strcmp( argv[arg], "-w" ) == 0 )
+    {
+      warmups = max( 0, atoi( argv[arg + 1] ));
+    }
+    else if ( strcmp( argv[arg], "-p" ) == 0 )
+    {
+      cpu = max( 0, atoi( argv[arg + 1] ));
+    }
+    else if ( strcmp( argv[arg], "-t" ) == 0 )
+    {
+      tolerance = max( 0, atoi( argv[arg + 1] )) / 100.0;
+    }
+    else if ( strcmp( argv[arg], "-T" ) == 0 )
+    {
+      time_tolerance = max( 0, atoi( argv[arg + 1] )) / 100.0;
+    }
+    else if ( strcmp( argv[arg], "-d" ) == 0 )
+    {
+      directory = argv[arg + 1];
+    }
+    else if ( strcmp( argv[arg], "-b" ) == 0 )
+    {
+      baseline_name = argv[arg + 1];
+    }
+    else if ( strcmp( argv[arg], "-o" ) == 0 )
+    {
+      output_name = argv[arg + 1];
+    }
+    else if ( strcmp( argv[arg], "-f" ) == 0 )
+    {
+      filter = argv[arg + 1];
+    }
+    else
+    {
+      break;
+    }
+  }
+  if ( arg != argc )
+  {
+    cout << "Usage: bench [-n trials] [-w warmups] [-p cpu] [-t tolerance%] [-T time tolerance%] [-d directory] [-b baseline|-]" << endl;
+    cout << "             [-o results] [-f case]" << endl;
+    cout << "  runs the corpus in directory and compares it with directory/bench/baseline.txt, or -b's baseline, or" << endl;
+    cout << "  with none for -b -; compares timings as well only if -T is given; writes the results to -o's file," << endl;
+    cout << "  and then a missing baseline isn't an error; and runs only the cases whose names contain -f's text" << endl;
+    return 1;
+  }
+  if ( baseline_name.empty() )
+  {
+    baseline_name = directory + "/bench/baseline.txt";
+  }
+
+  // the corpus is read, and parsed, before anything is timed
+  string euler_text;
+  string hard_text;
+  string nurikabe_text;
+  if ( !read_file( directory + "/sudoku.txt", euler_text ) || !read_file( directory + "/bench/hard17.txt", hard_text )
+       || !read_file( directory + "/bench/nurikabe.txt", nurikabe_text ))
+  {
+    cout << "can't read the corpus in " << directory << endl;
+    return 1;
+  }
+  const vector<Grid> euler = Solver::parse( euler_text.data(), euler_text.data() + euler_text.size() );
+  const vector<Grid> hard  = Solver::parse( hard_text.data(), hard_text.data() + hard_text.size() );
+  vector<nurikabe::Puzzle> nurikabe_puzzles;
+  try
+  {
+    nurikabe_puzzles = nurikabe::parse_puzzles( nurikabe_text.data(), nurikabe_text.data() + nurikabe_text.size() );
+  }
+  catch ( const exception& e )
+  {
+    cout << "bench/nurikabe.txt: " << e.what() << endl;
+    return 1;
+  }
+
+  // everything runs on this thread, so the solvers are given one thread each
+  if ( !pin_thread( cpu ))
+  {
+    cerr << "can't pin to cpu " << cpu << ", running unpinned" << endl;
+  }
+
+  auto solved = []( const vector<SolveResult>& results )
+  {
+    return static_cast<int>( count_if( results.begin(), results.end(), []( const SolveResult& result ) { return result.status == SolveResult::SOLVED; } ));
+  };
+  const int SUDOKU_PASSES = 100;
+  auto passes = [SUDOKU_PASSES]( const function<int()>& pass )
+  {
+    int ret = 0;
+    for ( int i = 0; i < SUDOKU_PASSES; ++i )
+    {
+      ret = pass();
+    }
+    return ret;
+  };
+  SolveOptions batched;
+  SolveOptions scalar;
+  scalar.batch = false;
+  SolveOptions counting;
+  counting.solution_limit = 2;
+
+  vector<Case> cases;
+  cases.push_back( { "sudoku/euler", static_cast<int>( euler.size() ), [&]() { return passes( [&]() { return solved( Solver( batched ).solve_all( euler )); } ); } } );
+  cases.push_back( { "sudoku/euler_scalar", static_cast<int>( euler.size() ), [&]() { return passes( [&]() { return solved( Solver( scalar ).solve_all( euler )); } ); } } );
+  cases.push_back( { "sudoku/hard17", static_cast<int>( hard.size() ), [&]() { return passes( [&]() { return solved( Solver( batched ).solve_all( hard )); } ); } } );
+  cases.push_back( { "sudoku/hard17_unique", static_cast<int>( hard.size() ), [&]()
+  {
+    return passes( [&]()
+    {
+      const vector<SolveResult> results = Solver( counting ).solve_all( hard );
+      return static_cast<int>( count_if( results.begin(), results.end(), []( const SolveResult& result ) { return result.unique(); } ));
+    });
+  } } );
+  for ( const nurikabe::Puzzle& puzzle : nurikabe_puzzles )
+  {
+    cases.push_back( { "nurikabe/" + puzzle.name, 1, [&puzzle]()
+    {
+      nurikabe::Grid::Options options;
+      options.recording = nurikabe::Grid::RECORD_NOTHING;
+      nurikabe::Grid grid( puzzle.width, puzzle.height, puzzle.s, options );
+      return nurikabe::solve( grid ) == nurikabe::Grid::SOLUTION_FOUND ? 1 : 0;
+    } } );
+  }
+
+  vector<Result> results;
+  write_header( cout );
+  try
+  {
+    for ( const Case& bench_case : cases )
+    {
+      if ( bench_case.name.find( filter ) != string::npos )
+      {
+        results.push_back( measure( bench_case, warmups, trials ));
+        write_result( cout, results.back() );
+      }
+    }
+  }
+  catch ( const exception& e )
+  {
+    cout << "exception: " << e.what() << endl;
+    return 1;
+  }
+
+  if ( !output_name.empty() )
+  {
+    ofstream output( output_name.c_str() );
+    write_header( output );
+    for ( const Result& result : results )
+    {
+      write_result( output, result );
+    }
+    if ( !output )
+    {
+      cerr << "can't write " << output_name << endl;
+      return 1;
+    }
+  }
+
+  string baseline_text;
+  if ( baseline_name == "-" )
+  {
+    return 0;
+  }
+  if ( !read_file( baseline_name, baseline_text ))
+  {
+    // without -o there's nothing to show for the run, and a missing baseline mustn't pass as no regressions
+    cerr << "no baseline in " << baseline_name << endl;
+    return output_name.empty() ? 1 : 0;
+  }
+  const int regressions = compare( results, read_results( baseline_text ), tolerance, time_tolerance );
+  cerr << regressions << ( regressions == 1 ? " regression" : " regressions" ) << endl;
+  return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,772 @@
+// Nurikabe Solver by Stephan T. Lavavej
+// The solver itself, for nurikabe.cpp and for programs that embed it. See nurikabe.cpp.
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "../Deadline.h"
+#include "../Trace.h"
+
+// Explicitly specified underlying types are now Standard.
+#pragma warning(disable: 4480)
+
+namespace nurikabe {
+
+using namespace std;
+
+// A bump allocator for memory that's all released at once. Each thread has one. While an
+// Arena::Scope is alive, ArenaAllocators that are constructed on its thread allocate from
+// the arena and never free anything, and when the Scope ends, everything that was allocated
+// during it is released. The blocks are kept, so later Scopes don't go back to the heap.
+class Arena {
+public:
+    class Scope {
+    public:
+        Scope() : m_arena(local()), m_previous(current()), m_block(m_arena.m_block), m_used(m_arena.m_used) {
+            current() = &m_arena;
+        }
+
+        ~Scope() {
+            m_arena.m_block = m_block;
+            m_arena.m_used = m_used;
+            current() = m_previous;
+        }
+
+    private:
+        Arena& m_arena;
+        Arena * m_previous;
+        size_t m_block;
+        size_t m_used;
+
+        Scope(const Scope&); // Not implemented.
+        Scope& operator=(const Scope&); // Not implemented.
+    };
+
+    // The arena of the innermost Scope on this thread, or null.
+    static Arena *& current() {
+        static thread_local Arena * arena = nullptr;
+        return arena;
+    }
+
+    void * allocate(const size_t n, const size_t alignment) {
+        for (;;) {
+            if (m_block < m_blocks.size()) {
+                const size_t start = (m_used + alignment - 1) / alignment * alignment;
+
+                if (start + n <= m_blocks[m_block].second) {
+                    m_used = start + n;
+                    return m_blocks[m_block].first.get() + start;
+                }
+            }
+
+            // Move on to the next block, inserting one if there isn't one or it's too small.
+
+            const size_t next = m_block < m_blocks.size() ? m_block + 1 : 0;
+
+            if (next == m_blocks.size() || m_blocks[next].second < n + alignment) {
+                const size_t size = n + alignment > BLOCK_SIZE ? n + alignment : BLOCK_SIZE;
+
+                m_blocks.insert(m_blocks.begin() + static_cast<ptrdiff_t>(next),
+                    make_pair(unique_ptr<char[]>(new char[size]), size));
+            }
+
+            m_block = next;
+            m_used = 0;
+        }
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 256 * 1024;
+
+    Arena() : m_blocks(), m_block(static_cast<size_t>(-1)), m_used(0) { }
+
+    static Arena& local() {
+        static thread_local Arena arena;
+        return arena;
+    }
+
+    // Memory from new char[] is aligned for any type, and block sizes don't change that.
+    vector<pair<unique_ptr<char[]>, size_t>> m_blocks;
+    size_t m_block; // The block being allocated from; m_blocks.size() or more means none yet.
+    size_t m_used;
+
+    Arena(const Arena&); // Not implemented.
+    Arena& operator=(const Arena&); // Not implemented.
+};
+
+// Allocates from the arena that was current when it was constructed, or uses new and delete.
+// Copies of containers take the current arena, not the arena of the container being copied.
+template <typename T> class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator() : m_arena(Arena::current()) { }
+
+    template <typename U> ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) { }
+
+    T * allocate(const size_t n) {
+        if (m_arena) {
+            return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T * const p, size_t) {
+        if (!m_arena) {
+            ::operator delete(p);
+        }
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const {
+        return ArenaAllocator();
+    }
+
+    Arena * arena() const {
+        return m_arena;
+    }
+
+private:
+    Arena * m_arena;
+};
+
+template <typename T, typename U> bool operator==(const ArenaAllocator<T>& l, const ArenaAllocator<U>& r) {
+    return l.arena() == r.arena();
+}
+
+template <typename T, typename U> bool operator!=(const ArenaAllocator<T>& l, const ArenaAllocator<U>& r) {
+    return l.arena() != r.arena();
+}
+
+template <typename T> using arena_vector = vector<T, ArenaAllocator<T>>;
+
+// Collects output in a fixed-size buffer and hands it to the stream a block at a time.
+// Whatever is left is written when the OutputBuffer is flushed or destroyed.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(ostream& os) : m_os(os), m_size(0) { }
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    OutputBuffer& operator<<(const char c) {
+        if (m_size == m_buf.size()) {
+            flush();
+        }
+
+        m_buf[m_size++] = c;
+        return *this;
+    }
+
+    OutputBuffer& operator<<(const char * const s) {
+        return append(s, strlen(s));
+    }
+
+    OutputBuffer& operator<<(const string& s) {
+        return append(s.data(), s.size());
+    }
+
+    OutputBuffer& operator<<(const long long n) {
+        // Digits are generated backwards, from the end of a buffer that's big enough for any long long.
+        char digits[24];
+        char * p = digits + sizeof(digits);
+        unsigned long long u = n < 0 ? 0ULL - static_cast<unsigned long long>(n) : n;
+
+        do {
+            *--p = static_cast<char>('0' + u % 10);
+            u /= 10;
+        } while (u != 0);
+
+        if (n < 0) {
+            *--p = '-';
+        }
+
+        return append(p, static_cast<size_t>(digits + sizeof(digits) - p));
+    }
+
+    OutputBuffer& operator<<(const int n) {
+        return *this << static_cast<long long>(n);
+    }
+
+    OutputBuffer& append(const char * s, size_t n) {
+        while (n > 0) {
+            if (m_size == m_buf.size()) {
+                flush();
+            }
+
+            const size_t k = min(n, m_buf.size() - m_size);
+
+            copy(s, s + k, m_buf.begin() + static_cast<ptrdiff_t>(m_size));
+            m_size += k;
+            s += k;
+            n -= k;
+        }
+
+        return *this;
+    }
+
+    // Writes s as a JSON string, with its quotes.
+    OutputBuffer& json_string(const string& s) {
+        *this << '"';
+
+        for (auto i = s.begin(); i != s.end(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(*i);
+
+            if (c == '"' || c == '\\') {
+                *this << '\\' << *i;
+            } else if (c < 0x20) {
+                const char * const hex = "0123456789abcdef";
+                *this << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+            } else {
+                *this << *i;
+            }
+        }
+
+        return *this << '"';
+    }
+
+    void flush() {
+        m_os.write(m_buf.data(), static_cast<streamsize>(m_size));
+        m_size = 0;
+    }
+
+private:
+    ostream& m_os;
+    array<char, 64 * 1024> m_buf;
+    size_t m_size;
+
+    OutputBuffer(const OutputBuffer&); // Not implemented.
+    OutputBuffer& operator=(const OutputBuffer&); // Not implemented.
+};
+
+class Grid {
+public:
+    // How the steps of solving are recorded for write().
+    enum Recording {
+        RECORD_BOARDS, // A copy of the board for every step.
+        RECORD_DELTAS, // Only the cells that each step changed.
+        RECORD_NOTHING // Nothing, so write() has nothing to show.
+    };
+
+    struct Options {
+        Options() : threads(1), copy_confinement(false), recording(RECORD_BOARDS), assume_unique(true) { }
+
+        // The number of threads that hypothetical contradiction analysis uses.
+        int threads;
+
+        // Whether hypothetical grids start with a copy of the confinement analysis cache.
+        bool copy_confinement;
+
+        Recording recording;
+
+        // Whether the puzzle is known to have a unique solution. Hypothetical contradiction analysis
+        // takes a guess that leads to a solution to be right, which is only true if it's the only
+        // solution. Without that, such a guess is treated as having failed, and SOLUTION_FOUND means
+        // that the solution was deduced, so it's the only one.
+        bool assume_unique;
+
+        // When solving has to stop. Once it has expired, solve() returns TIMED_OUT, leaving the
+        // board as far as it got. Hypothetical grids check their own copies.
+        Deadline deadline;
+    };
+
+    Grid(int width, int height, const string& s, const Options& options = Options());
+
+    enum SitRep {
+        CONTRADICTION_FOUND,
+        SOLUTION_FOUND,
+        KEEP_GOING,
+        CANNOT_PROCEED,
+        TIMED_OUT
+    };
+
+    SitRep solve(bool verbose = true, bool guessing = true);
+
+    int known() const;
+
+    void write(ostream& os, Clock::time_point start, Clock::time_point finish) const;
+
+    // The board as it stands, a string per row, written like puzzles are, with '#' for black
+    // and '.' for white. Unknown cells are spaces.
+    vector<string> rows() const;
+
+    // Writes one line of JSON: the puzzle's name, size, rows() and timing, and the
+    // message and time of each recorded step.
+    void write_json(ostream& os, const string& name,
+        Clock::time_point start, Clock::time_point finish) const;
+
+    // Writes the board as one packed record. See read_packed_puzzles() for the format.
+    void write_packed(ostream& os) const;
+
+    // When a trace is set, solve() records a sample as it starts each step of analysis.
+    // Hypothetical grids aren't traced.
+    typedef TraceBuffer<4096> Trace;
+
+    void set_trace(Trace * trace);
+
+private:
+    // The states that a cell can be in. Numbered cells are positive,
+    // which is why this has an explicitly specified underlying type.
+    enum State : int {
+        UNKNOWN = -3,
+        WHITE = -2,
+        BLACK = -1
+    };
+
+    // A set of cells, stored as one bit per cell so that copying and merging sets costs
+    // word-level operations. Cell (x, y) is bit x * height + y, which means that iteration
+    // visits cells in the same order as set<pair<int, int>>.
+    class CellSet {
+    public:
+        CellSet(const int width, const int height)
+            : m_width(width), m_height(height), m_size(0), m_bits((width * height + 63) / 64, 0) { }
+
+        class const_iterator {
+        public:
+            typedef forward_iterator_tag iterator_category;
+            typedef pair<int, int> value_type;
+            typedef ptrdiff_t difference_type;
+            typedef const pair<int, int> * pointer;
+            typedef const pair<int, int>& reference;
+
+            const_iterator(const CellSet& s, const int index)
+                : m_set(&s), m_index(s.find(index)), m_cell(s.coords(m_index)) { }
+
+            reference operator*() const {
+                return m_cell;
+            }
+
+            pointer operator->() const {
+                return &m_cell;
+            }
+
+            const_iterator& operator++() {
+                m_index = m_set->find(m_index + 1);
+                m_cell = m_set->coords(m_index);
+                return *this;
+            }
+
+            const_iterator operator++(int) {
+                const_iterator ret(*this);
+                ++*this;
+                return ret;
+            }
+
+            bool operator==(const const_iterator& other) const {
+                return m_index == other.m_index;
+            }
+
+            bool operator!=(const const_iterator& other) const {
+                return m_index != other.m_index;
+            }
+
+        private:
+            const CellSet * m_set;
+            int m_index;
+            pair<int, int> m_cell;
+        };
+
+        const_iterator begin() const {
+            return const_iterator(*this, 0);
+        }
+
+        const_iterator end() const {
+            return const_iterator(*this, limit());
+        }
+
+        int width() const {
+            return m_width;
+        }
+
+        int height() const {
+            return m_height;
+        }
+
+        int size() const {
+            return m_size;
+        }
+
+        bool contains(const int x, const int y) const {
+            const int i = x * m_height + y;
+            return (m_bits[i / 64] >> (i % 64) & 1) != 0;
+        }
+
+        bool intersects(const CellSet& other) const {
+            for (size_t w = 0; w < m_bits.size(); ++w) {
+                if ((m_bits[w] & other.m_bits[w]) != 0) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void insert(const int x, const int y) {
+            const int i = x * m_height + y;
+            const unsigned long long bit = 1ULL << (i % 64);
+
+            if ((m_bits[i / 64] & bit) == 0) {
+                m_bits[i / 64] |= bit;
+                ++m_size;
+            }
+        }
+
+        void insert(const CellSet& other) {
+            m_size = 0;
+
+            for (size_t w = 0; w < m_bits.size(); ++w) {
+                m_bits[w] |= other.m_bits[w];
+                m_size += static_cast<int>(bitset<64>(m_bits[w]).count());
+            }
+        }
+
+        void erase(const int x, const int y) {
+            const int i = x * m_height + y;
+            const unsigned long long bit = 1ULL << (i % 64);
+
+            if ((m_bits[i / 64] & bit) != 0) {
+                m_bits[i / 64] &= ~bit;
+                --m_size;
+            }
+        }
+
+    private:
+        int limit() const {
+            return static_cast<int>(m_bits.size()) * 64;
+        }
+
+        // The index of the first cell at or after i, or limit() if there isn't one.
+        int find(const int i) const {
+            if (i >= limit()) {
+                return limit();
+            }
+
+            size_t w = i / 64;
+            unsigned long long word = m_bits[w] & ~0ULL << (i % 64);
+
+            while (word == 0) {
+                if (++w == m_bits.size()) {
+                    return limit();
+                }
+
+                word = m_bits[w];
+            }
+
+            // The number of bits below the lowest set bit is its position within the word.
+            return static_cast<int>(w * 64 + bitset<64>((word & (0 - word)) - 1).count());
+        }
+
+        pair<int, int> coords(const int i) const {
+            return make_pair(i / m_height, i % m_height);
+        }
+
+        int m_width;
+        int m_height;
+        int m_size;
+        arena_vector<unsigned long long> m_bits;
+    };
+
+    // Each region is black, white, or numbered. This allows us to
+    // remember when white cells are connected to numbered cells,
+    // as the whole region is marked as numbered.
+    // Each region keeps track of the coordinates that it occupies.
+    // Each region also keeps track of the unknown cells that it's surrounded by.
+    class Region {
+    public:
+        Region(const State state, const int x, const int y, const CellSet& unknowns)
+            : m_state(state), m_coords(unknowns.width(), unknowns.height()), m_unknowns(unknowns) {
+
+            if (state == UNKNOWN) {
+                throw logic_error("LOGIC ERROR: Grid::Region::Region() - state must be known!");
+            }
+
+            m_coords.insert(x, y);
+        }
+
+
+        bool white() const {
+            return m_state == WHITE;
+        }
+
+        bool black() const {
+            return m_state == BLACK;
+        }
+
+        bool numbered() const {
+            return m_state > 0;
+        }
+
+        int number() const {
+            if (!numbered()) {
+                throw logic_error(
+                    "LOGIC ERROR: Grid::Region::number() - This region is not numbered!");
+            }
+
+            return m_state;
+        }
+
+
+        CellSet::const_iterator begin() const {
+            return m_coords.begin();
+        }
+
+        CellSet::const_iterator end() const {
+            return m_coords.end();
+        }
+
+        int size() const {
+            return m_coords.size();
+        }
+
+        bool contains(const int x, const int y) const {
+            return m_coords.contains(x, y);
+        }
+
+        const CellSet& coords() const {
+            return m_coords;
+        }
+
+        const CellSet& unknowns() const {
+            return m_unknowns;
+        }
+
+        // Add the other region's cells to this region.
+        void insert(const Region& other) {
+            m_coords.insert(other.m_coords);
+        }
+
+
+        CellSet::const_iterator unk_begin() const {
+            return m_unknowns.begin();
+        }
+
+        CellSet::const_iterator unk_end() const {
+            return m_unknowns.end();
+        }
+
+        int unk_size() const {
+            return m_unknowns.size();
+        }
+
+        // Add the other region's surrounding unknown cells to this region's.
+        void unk_insert(const Region& other) {
+            m_unknowns.insert(other.m_unknowns);
+        }
+
+        void unk_erase(const int x, const int y) {
+            m_unknowns.erase(x, y);
+        }
+
+    private:
+        State m_state;
+        CellSet m_coords;
+        CellSet m_unknowns;
+    };
+
+    // A confinement analysis result, and the cells that the flood fill looked at to reach it.
+    // It stays correct until one of those cells is marked or becomes part of a fused region.
+    // Without verboten cells, we also record the unknown cells that we consumed.
+    struct Confinement {
+        Confinement(const bool c, const CellSet& cells)
+            : confined(c), consumed(cells), touched(cells) { }
+
+        bool confined;
+        CellSet consumed;
+        CellSet touched;
+    };
+
+    // Confinement results are keyed by region and by which cells were verboten:
+    // NO_VERBOTEN, a cell's index, or CELL_AND_NEIGHBORS plus a cell's index.
+    enum : int {
+        NO_VERBOTEN = -1,
+        CELL_AND_NEIGHBORS = 1 << 24
+    };
+
+    typedef map<pair<shared_ptr<Region>, int>, Confinement, less<pair<shared_ptr<Region>, int>>,
+        ArenaAllocator<pair<const pair<shared_ptr<Region>, int>, Confinement>>> cache_map_t;
+
+    bool analyze_complete_islands(bool verbose);
+    bool analyze_single_liberties(bool verbose);
+    bool analyze_dual_liberties(bool verbose);
+    bool analyze_unreachable_cells(bool verbose);
+    bool analyze_potential_pools(bool verbose);
+    bool analyze_confinement(bool verbose);
+    const vector<pair<int, int>>& guessing_order();
+    bool analyze_hypotheticals(bool verbose);
+
+    bool trace(const char * label);
+    bool out_of_time(bool verbose);
+
+    template <typename F> SitRep hypothetical(State color, int x, int y, F cancelled) const;
+    int parallel_hypotheticals(const vector<pair<int, int>>& v, SitRep& sr) const;
+
+    // We use an upper-left origin.
+    // This is convenient during construction and printing.
+    // It's irrelevant during analysis.
+
+    bool valid(int x, int y) const;
+
+    State& cell(int x, int y);
+    const State& cell(int x, int y) const;
+
+    shared_ptr<Region>& region(int x, int y);
+    const shared_ptr<Region>& region(int x, int y) const;
+
+    void record_change(int x, int y);
+    void print(const string& s, const set<pair<int, int>>& updated = set<pair<int, int>>(),
+        int failed_guesses = 0, const set<pair<int, int>>& failed_coords = set<pair<int, int>>());
+    bool process(bool verbose, const set<pair<int, int>>& mark_as_black,
+        const set<pair<int, int>>& mark_as_white, const string& s,
+        int failed_guesses = 0, const set<pair<int, int>>& failed_coords = set<pair<int, int>>());
+
+    template <typename F> void for_valid_neighbors(int x, int y, F f) const;
+    void insert_valid_neighbors(set<pair<int, int>>& s, int x, int y) const;
+    void insert_valid_unknown_neighbors(set<pair<int, int>>& s, int x, int y) const;
+
+    void add_region(int x, int y);
+    void mark(State s, int x, int y);
+    void fuse_regions(shared_ptr<Region> r1, shared_ptr<Region> r2);
+
+    bool impossibly_big_white_region(int n) const;
+
+    bool unreachable(int x_root, int y_root,
+        set<pair<int, int>> discovered = set<pair<int, int>>()) const;
+
+    bool confined(const shared_ptr<Region>& r, int key = NO_VERBOTEN,
+        const set<pair<int, int>>& verboten = set<pair<int, int>>());
+    bool flood_confined(const shared_ptr<Region>& r, const set<pair<int, int>>& verboten,
+        CellSet& consumed, CellSet& touched) const;
+    void invalidate_confinement(const Region& changed);
+
+    bool detect_contradictions(bool verbose);
+
+
+    int m_width; // x is valid within [0, m_width).
+    int m_height; // y is valid within [0, m_height).
+    int m_total_black; // The total number of black cells that will be in the solution.
+
+    // m_cells[x][y].first is the state of a cell.
+    // m_cells[x][y].second is the region of a cell.
+    // (If the state is unknown, the region is empty.)
+    arena_vector<arena_vector<pair<State, shared_ptr<Region>>>> m_cells;
+
+    // The set of all regions can be traversed in linear time.
+    set<shared_ptr<Region>, less<shared_ptr<Region>>, ArenaAllocator<shared_ptr<Region>>> m_regions;
+
+    // This is initially KEEP_GOING.
+    // If an attempt is made to fuse two numbered regions, or to mark an already known cell,
+    // this is set to CONTRADICTION_FOUND.
+    SitRep m_sitrep;
+
+    // One step of the output that is generated during solving, to be converted into HTML later.
+    // Depending on the recording, either board holds every cell or changes holds the cells
+    // that have been set since the previous step.
+    struct Step {
+        string message;
+        vector<vector<State>> board;
+        vector<tuple<int, int, State>> changes;
+        set<pair<int, int>> updated;
+        Clock::time_point time;
+        int failed_guesses;
+        set<pair<int, int>> failed_coords;
+    };
+
+    vector<Step> m_output;
+
+    // With RECORD_DELTAS, the cells that have been set since the last step was recorded.
+    vector<tuple<int, int, State>> m_changes;
+
+    // This is used to guess cells in a deterministic but pseudorandomized order.
+    mt19937 m_prng;
+
+    Options m_options;
+
+    // Confinement analysis results that are still correct.
+    cache_map_t m_confinement;
+
+    // Where solve() records its steps, if anywhere.
+    Trace * m_trace;
+
+    // guessing_order()'s buffers, which are kept to avoid reallocating them for every call.
+    vector<int> m_distance;
+    vector<pair<int, int>> m_unknowns;
+    vector<int> m_counts;
+    vector<pair<int, int>> m_guessing_order;
+
+    Grid(const Grid& other);
+    Grid& operator=(const Grid& other); // Not implemented.
+};
+
+struct Puzzle {
+    string name;
+    int width;
+    int height;
+    string s;
+};
+
+// Read puzzles until the end of the stream. Each puzzle is a line "width height [name]"
+// followed by height lines, written like the puzzles in nurikabe.cpp without the quotes.
+// Blank lines between puzzles are ignored, but not within them, because a row of unknown
+// cells is blank. Puzzles without names are named by their position. source names the
+// stream in exceptions.
+vector<Puzzle> read_puzzles(istream& is, const string& source);
+
+// The same, for puzzles that are already in memory.
+vector<Puzzle> parse_puzzles(const char * first, const char * last);
+
+// Packed puzzles and boards, for bulk I/O. A record is the width and then the height, two bytes
+// each with the low byte first, followed by a nibble per cell, row by row, two to a byte with the
+// first in the low nibble, and the record ends at the end of a byte. 0 is an unknown cell, 1 to 12
+// are numbers, 13 is a larger number held in the next two nibbles (low first), 14 is white and 15
+// is black. Records follow one another directly. Puzzles are named by their position, like the
+// puzzles in text without names. A record that isn't a puzzle (it has white or black cells, or
+// numbers next to each other) is an error.
+vector<Puzzle> read_packed_puzzles(istream& is, const string& source);
+
+// Writes a puzzle as one packed record, or in text as read_puzzles() reads it.
+void write_packed_puzzle(ostream& os, const Puzzle& p);
+void write_text_puzzle(ostream& os, const Puzzle& p);
+
+// Writes a packed record of a board whose cells are all unknown, for a puzzle that couldn't be solved.
+void write_packed_unknown(ostream& os, int width, int height);
+
+// Solve until solving can make no more progress, and return the final SitRep.
+Grid::SitRep solve(Grid& g);
+
+// A puzzle made by generate_puzzle(), how hard it was to solve (the number of steps of analysis,
+// and how many of those needed hypothetical contradiction analysis), and how many random boards
+// were tried to make it.
+struct Generated {
+    Puzzle puzzle;
+    int steps;
+    int hypotheticals;
+    int attempts;
+};
+
+// Makes a random puzzle with a unique solution, needing at least min_hypotheticals steps of
+// hypothetical contradiction analysis. Random solved boards are grown by putting white cells in
+// pools, one number is put in each island, and the first puzzle that the solver can deduce
+// completely without assume_unique is kept. The puzzle depends only on the seed and the index,
+// so puzzles can be made in any order and on any number of threads. Width and height must be
+// at least 2.
+Generated generate_puzzle(int width, int height, unsigned int seed, unsigned int index,
+    int min_hypotheticals = 0);
+
+} // namespace nurikabe
@@ -0,0 +1,2018 @@
+// Nurikabe Solver by Stephan T. Lavavej
+// The solver itself. See nurikabe.cpp.
+
+#include <stdlib.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include "nurikabe.h"
+
+namespace nurikabe {
+
+vector<Puzzle> read_puzzles(istream& is, const string& source) {
+    vector<Puzzle> ret;
+    string line;
+    int line_number = 0;
+
+    const auto next_line = [&]() -> bool {
+        if (!getline(is, line)) {
+            return false;
+        }
+
+        ++line_number;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        return true;
+    };
+
+    while (next_line()) {
+        if (line.find_first_not_of(" \t") == string::npos) {
+            continue;
+        }
+
+        Puzzle p;
+        istringstream header(line);
+
+        if (!(header >> p.width >> p.height) || p.width < 1 || p.height < 1) {
+            throw runtime_error("RUNTIME ERROR: read_puzzles() - " + source + ":"
+                + to_string(line_number) + " should be \"width height [name]\".");
+        }
+
+        if (!(header >> p.name)) {
+            p.name = "puzzle_" + to_string(ret.size() + 1);
+        }
+
+        for (int y = 0; y < p.height; ++y) {
+            if (!next_line()) {
+                throw runtime_error("RUNTIME ERROR: read_puzzles() - "
+                    + source + " ends in the middle of " + p.name + ".");
+            }
+
+            p.s += line;
+            p.s += '\n';
+        }
+
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+
+vector<Puzzle> parse_puzzles(const char * const first, const char * const last) {
+    istringstream is(string(first, last));
+
+    return read_puzzles(is, "buffer");
+}
+
+namespace {
+    // Nibbles of a packed record, written or read two to a byte, the first in the low nibble.
+    class NibbleWriter {
+    public:
+        NibbleWriter(const int width, const int height) : m_bytes(), m_odd(false) {
+            if (width < 0 || width > 0xFFFF || height < 0 || height > 0xFFFF) {
+                throw runtime_error("RUNTIME ERROR: NibbleWriter::NibbleWriter() - "
+                    "a packed record can't be larger than 65535 x 65535.");
+            }
+
+            m_bytes.push_back(static_cast<char>(width & 0xFF));
+            m_bytes.push_back(static_cast<char>(width >> 8));
+            m_bytes.push_back(static_cast<char>(height & 0xFF));
+            m_bytes.push_back(static_cast<char>(height >> 8));
+        }
+
+        void push(const int nibble) {
+            if (m_odd) {
+                m_bytes.back() = static_cast<char>(m_bytes.back() | (nibble << 4));
+            } else {
+                m_bytes.push_back(static_cast<char>(nibble));
+            }
+
+            m_odd = !m_odd;
+        }
+
+        // Numbers, escaped when they don't fit in a nibble of their own.
+        void push_number(const int n) {
+            if (n <= 12) {
+                push(n);
+            } else if (n <= 0xFF) {
+                push(13);
+                push(n & 0xF);
+                push(n >> 4);
+            } else {
+                throw runtime_error("RUNTIME ERROR: NibbleWriter::push_number() - "
+                    "a packed record can't hold numbers larger than 255.");
+            }
+        }
+
+        void write(ostream& os) const {
+            os.write(m_bytes.data(), static_cast<streamsize>(m_bytes.size()));
+        }
+
+    private:
+        string m_bytes;
+        bool m_odd;
+    };
+
+    class NibbleReader {
+    public:
+        NibbleReader(istream& is, const string& source) : m_is(is), m_source(source), m_byte(0), m_odd(false) { }
+
+        // Starts the next record, returning false at the end of the stream.
+        bool start(int& width, int& height) {
+            unsigned char header[4];
+
+            m_is.read(reinterpret_cast<char *>(header), sizeof(header));
+
+            if (m_is.gcount() == 0) {
+                return false;
+            }
+
+            if (m_is.gcount() != sizeof(header)) {
+                truncated();
+            }
+
+            width = header[0] | header[1] << 8;
+            height = header[2] | header[3] << 8;
+            m_odd = false;
+            return true;
+        }
+
+        int pop() {
+            if (m_odd) {
+                m_odd = false;
+                return m_byte >> 4;
+            }
+
+            const int c = m_is.get();
+
+            if (c == EOF) {
+                truncated();
+            }
+
+            m_byte = c;
+            m_odd = true;
+            return m_byte & 0xF;
+        }
+
+        // A cell: a number, 0 if it's unknown, or -1 if it's white or black.
+        int pop_cell() {
+            const int nibble = pop();
+
+            if (nibble == 14 || nibble == 15) {
+                return -1;
+            }
+
+            if (nibble != 13) {
+                return nibble;
+            }
+
+            const int low = pop();
+
+            return low | pop() << 4;
+        }
+
+    private:
+        [[noreturn]] void truncated() const {
+            throw runtime_error("RUNTIME ERROR: read_packed_puzzles() - "
+                + m_source + " ends in the middle of a record.");
+        }
+
+        istream& m_is;
+        const string& m_source;
+        int m_byte;
+        bool m_odd;
+    };
+}
+
+vector<Puzzle> read_packed_puzzles(istream& is, const string& source) {
+    vector<Puzzle> ret;
+    NibbleReader r(is, source);
+    Puzzle p;
+
+    while (r.start(p.width, p.height)) {
+        p.name = "puzzle_" + to_string(ret.size() + 1);
+        p.s.clear();
+
+        for (int y = 0; y < p.height; ++y) {
+            bool number = false;
+
+            for (int x = 0; x < p.width; ++x) {
+                const int n = r.pop_cell();
+
+                if (n < 0 || (number && n > 0)) {
+                    throw runtime_error("RUNTIME ERROR: read_packed_puzzles() - "
+                        + source + " record " + to_string(ret.size() + 1) + " isn't a puzzle.");
+                }
+
+                number = n > 0;
+                p.s += number ? to_string(n) : " ";
+            }
+
+            p.s += '\n';
+        }
+
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+
+void write_packed_puzzle(ostream& os, const Puzzle& p) {
+    Grid::Options options;
+
+    options.recording = Grid::RECORD_NOTHING;
+
+    Grid(p.width, p.height, p.s, options).write_packed(os);
+}
+
+void write_text_puzzle(ostream& os, const Puzzle& p) {
+    os << p.width << " " << p.height << " " << p.name << "\n" << p.s;
+}
+
+void write_packed_unknown(ostream& os, const int width, const int height) {
+    const int w = max(0, width);
+    const int h = max(0, height);
+    NibbleWriter out(w, h);
+
+    for (int i = 0; i < w * h; ++i) {
+        out.push(0);
+    }
+
+    out.write(os);
+}
+
+Grid::SitRep solve(Grid& g) {
+    Grid::SitRep sr = Grid::KEEP_GOING;
+
+    while ((sr = g.solve()) == Grid::KEEP_GOING) { }
+
+    return sr;
+}
+
+namespace {
+    // A random solved board for generate_puzzle(), as the island of each cell, or -1 for black,
+    // and the size of each island. While there are pools, a cell of one of them is made white, as
+    // a new island or as part of the one island next to it, as long as the black cells stay
+    // connected. Returns false if no cell can be.
+    bool random_board(const int width, const int height, mt19937& prng,
+        vector<int>& board, vector<int>& sizes) {
+
+        const int cells = width * height;
+        const int largest = max(2, (width + height) / 2);
+
+        board.assign(cells, -1);
+        sizes.clear();
+
+        vector<int> candidates;
+        vector<int> queue;
+        vector<bool> seen;
+
+        auto black_connected = [&](const int whitened, const int black_cells) {
+            seen.assign(cells, false);
+            queue.clear();
+
+            for (int i = 0; i < cells && queue.empty(); ++i) {
+                if (board[i] == -1 && i != whitened) {
+                    seen[i] = true;
+                    queue.push_back(i);
+                }
+            }
+
+            for (size_t q = 0; q < queue.size(); ++q) {
+                const int x = queue[q] % width;
+                const int y = queue[q] / width;
+                const int neighbors[] = { x > 0 ? queue[q] - 1 : -1, x + 1 < width ? queue[q] + 1 : -1,
+                    y > 0 ? queue[q] - width : -1, y + 1 < height ? queue[q] + width : -1 };
+
+                for (auto n : neighbors) {
+                    if (n != -1 && !seen[n] && board[n] == -1 && n != whitened) {
+                        seen[n] = true;
+                        queue.push_back(n);
+                    }
+                }
+            }
+
+            return static_cast<int>(queue.size()) == black_cells - 1;
+        };
+
+        for (int black_cells = cells; ; --black_cells) {
+            candidates.clear();
+
+            for (int x = 0; x + 1 < width; ++x) {
+                for (int y = 0; y + 1 < height; ++y) {
+                    const int i = x + y * width;
+
+                    if (board[i] == -1 && board[i + 1] == -1
+                        && board[i + width] == -1 && board[i + width + 1] == -1) {
+
+                        candidates.insert(candidates.end(), { i, i + 1, i + width, i + width + 1 });
+                    }
+                }
+            }
+
+            if (candidates.empty()) {
+                return !sizes.empty();
+            }
+
+            sort(candidates.begin(), candidates.end());
+            candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+            shuffle(candidates.begin(), candidates.end(), prng);
+
+            bool whitened = false;
+
+            for (auto i = candidates.begin(); i != candidates.end() && !whitened; ++i) {
+                const int x = *i % width;
+                const int y = *i / width;
+                const int neighbors[] = { x > 0 ? *i - 1 : -1, x + 1 < width ? *i + 1 : -1,
+                    y > 0 ? *i - width : -1, y + 1 < height ? *i + width : -1 };
+
+                int island = -1;
+                bool joins_two = false;
+
+                for (auto n : neighbors) {
+                    if (n != -1 && board[n] != -1) {
+                        joins_two |= island != -1 && island != board[n];
+                        island = board[n];
+                    }
+                }
+
+                if (joins_two || (island != -1 && sizes[island] == largest)
+                    || !black_connected(*i, black_cells)) {
+                    continue;
+                }
+
+                if (island == -1) {
+                    island = static_cast<int>(sizes.size());
+                    sizes.push_back(0);
+                }
+
+                board[*i] = island;
+                ++sizes[island];
+                whitened = true;
+            }
+
+            if (!whitened) {
+                return false;
+            }
+        }
+    }
+}
+
+Generated generate_puzzle(const int width, const int height,
+    const unsigned int seed, const unsigned int index, const int min_hypotheticals) {
+
+    if (width < 2 || height < 2) {
+        throw runtime_error("RUNTIME ERROR: generate_puzzle() - width and height must be at least 2.");
+    }
+
+    static const int MAX_ATTEMPTS = 100000;
+
+    seed_seq sequence = { seed, index };
+    mt19937 prng(sequence);
+
+    Grid::Options options;
+
+    options.recording = Grid::RECORD_NOTHING;
+    options.assume_unique = false;
+
+    unique_ptr<Grid::Trace> trace(new Grid::Trace);
+    vector<int> board;
+    vector<int> sizes;
+    vector<int> numbered;
+
+    for (int attempts = 1; attempts <= MAX_ATTEMPTS; ++attempts) {
+        if (!random_board(width, height, prng, board, sizes)) {
+            continue;
+        }
+
+        // Each island's number goes in one of its cells, chosen at random.
+
+        numbered.assign(sizes.size(), 0);
+
+        vector<int> seen(sizes.size(), 0);
+
+        for (int i = 0; i < width * height; ++i) {
+            if (board[i] != -1 && uniform_int_distribution<int>(0, seen[board[i]]++)(prng) == 0) {
+                numbered[board[i]] = i;
+            }
+        }
+
+        Generated ret = { { string(), width, height, string() }, 0, 0, attempts };
+        string& s = ret.puzzle.s;
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const int i = x + y * width;
+
+                if (board[i] != -1 && numbered[board[i]] == i) {
+                    s += to_string(sizes[board[i]]);
+                } else {
+                    s += ' ';
+                }
+            }
+
+            s += '\n';
+        }
+
+        Grid g(width, height, s, options);
+
+        trace->clear();
+        g.set_trace(trace.get());
+
+        Grid::SitRep sr = Grid::KEEP_GOING;
+
+        while ((sr = g.solve()) == Grid::KEEP_GOING) {
+            ++ret.steps;
+        }
+
+        for (size_t i = 0; i < trace->size(); ++i) {
+            ret.hypotheticals += string((*trace)[i].label) == "hypotheticals";
+        }
+
+        if (sr == Grid::SOLUTION_FOUND && ret.hypotheticals >= min_hypotheticals) {
+            return ret;
+        }
+    }
+
+    throw runtime_error("RUNTIME ERROR: generate_puzzle() - gave up after "
+        + to_string(MAX_ATTEMPTS) + " attempts.");
+}
+
+Grid::Grid(const int width, const int height, const string& s, const Options& options)
+    : m_width(width), m_height(height), m_total_black(width * height),
+    m_cells(), m_regions(), m_sitrep(KEEP_GOING), m_output(), m_changes(), m_prng(1729),
+    m_options(options), m_confinement(), m_trace(nullptr),
+    m_distance(), m_unknowns(), m_counts(), m_guessing_order() {
+
+    // Validate width and height.
+
+    if (width < 1) {
+        throw runtime_error("RUNTIME ERROR: Grid::Grid() - width must be at least 1.");
+    }
+
+    if (height < 1) {
+        throw runtime_error("RUNTIME ERROR: Grid::Grid() - height must be at least 1.");
+    }
+
+    // Initialize m_cells. We must set everything to UNKNOWN before calling add_region() below.
+
+    m_cells.resize(width, 
+                   arena_vector< pair< State, shared_ptr<Region> >>( height, make_pair(UNKNOWN, shared_ptr<Region>())));
+
+    // Parse the string.
+
+    vector<int> v;
+
+    const regex r("(\\d+)|( )|(\\n)|[^\\d \\n]");
+
+    for (sregex_iterator i(s.begin(), s.end(), r), end; i != end; ++i) {
+        const smatch& m = *i;
+
+        if (m[1].matched) {
+            v.push_back(stoi(m[1]));
+        } else if (m[2].matched) {
+            v.push_back(0);
+        } else if (m[3].matched) {
+            // Do nothing.
+        } else {
+            throw runtime_error("RUNTIME ERROR: Grid::Grid() - "
+                "s must contain only digits, spaces, and newlines.");
+        }
+    }
+
+    // Validate the number of cells. Note that we can't do this before
+    // parsing, because numbers 10 and above occupy multiple characters.
+
+    if (v.size() != static_cast<size_t>(width * height)) {
+        throw runtime_error("RUNTIME ERROR: Grid::Grid() - "
+            "s must contain width * height numbers and spaces.");
+    }
+
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+            const int n = v[x + y * width];
+
+            if (n > 0) {
+                // Testing x - 1 and x + 1 is unnecessary because
+                // horizontally adjacent numbers would have been concatenated.
+                // Testing y + 1 is unnecessary because if there are
+                // vertically adjacent numbers, one's above and one's below.
+
+                if (valid(x, y - 1) && cell(x, y - 1) > 0) {
+                    throw runtime_error("RUNTIME ERROR: Grid::Grid() - "
+                        "s contains vertically adjacent numbers.");
+                }
+
+                // Set the cell's state and region.
+
+                cell(x, y) = static_cast<State>(n);
+
+                record_change(x, y);
+
+                add_region(x, y);
+
+                // m_total_black is width * height - (sum of all numbered cells).
+                // Calculating this allows us to determine whether black regions
+                // are partial or complete with a simple size test.
+                // Humans are capable of this but it's not convenient for them.
+                // We will show the meatbags that silicon is the superior element!
+
+                m_total_black -= n;
+            }
+        }
+    }
+
+    print("I'm okay to go!");
+}
+
+Grid::SitRep Grid::solve(const bool requested_verbose, const bool guessing) {
+    // Without a recording, there's nobody to be verbose for.
+
+    const bool verbose = requested_verbose && m_options.recording != RECORD_NOTHING;
+
+    // See if we're done. Before declaring victory, look for contradictions.
+
+    if (known() == m_width * m_height) {
+        if (detect_contradictions(verbose)) {
+            return CONTRADICTION_FOUND;
+        }
+
+        if (verbose) {
+            print("I'm done!");
+        }
+
+        return SOLUTION_FOUND;
+    }
+
+    if (out_of_time(verbose)) {
+        return m_sitrep;
+    }
+
+
+    // Run increasingly expensive steps of analysis.
+    // Return as soon as one succeeds.
+
+    // Running detect_contradictions() just before analyze_confinement() increases performance.
+    // detect_contradictions() is moderately expensive, so it should be run after extremely cheap
+    // steps of analysis. However, detect_contradictions() accelerates analyze_confinement(),
+    // which is even more expensive. This doesn't affect correctness:
+    // * We always run detect_contradictions() before declaring victory.
+    // * The other steps of analysis are robust; if they attempt to fuse two numbered regions
+    // or mark an already known cell, they bail out early.
+    // * analyze_confinement() can still assume that every region's confinement without verboten
+    // cells is in the cache.
+
+    // trace() always returns false, so that it can be chained in front of each step.
+
+    if (trace("complete islands") || analyze_complete_islands(verbose)
+        || trace("single liberties") || analyze_single_liberties(verbose)
+        || trace("dual liberties") || analyze_dual_liberties(verbose)
+        || trace("unreachable cells") || analyze_unreachable_cells(verbose)
+        || trace("potential pools") || analyze_potential_pools(verbose)
+        || trace("contradictions") || detect_contradictions(verbose)
+        || trace("confinement") || analyze_confinement(verbose)
+        || (guessing && (trace("hypotheticals") || analyze_hypotheticals(verbose)))) {
+
+        return m_sitrep;
+    }
+
+
+    if (verbose) {
+        print("I'm stumped!");
+    }
+
+    return CANNOT_PROCEED;
+}
+
+// Look for complete islands.
+bool Grid::analyze_complete_islands(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        const Region& r = **i;
+
+        if (r.numbered() && r.size() == r.number()) {
+            mark_as_black.insert(r.unk_begin(), r.unk_end());
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white, "Complete islands found.");
+}
+
+// Look for partial regions that can expand into only one cell. They must expand.
+bool Grid::analyze_single_liberties(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        const Region& r = **i;
+
+        const bool partial =
+            r.black() && r.size() < m_total_black
+                || r.white()
+                || r.numbered() && r.size() < r.number();
+
+        if (partial && r.unk_size() == 1) {
+            if (r.black()) {
+                mark_as_black.insert(*r.unk_begin());
+            } else {
+                mark_as_white.insert(*r.unk_begin());
+            }
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white,
+        "Expanded partial regions with only one liberty.");
+}
+
+// Look for N - 1 islands with exactly two diagonal liberties.
+bool Grid::analyze_dual_liberties(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        const Region& r = **i;
+
+        if (r.numbered() && r.size() == r.number() - 1 && r.unk_size() == 2) {
+            const int x1 = r.unk_begin()->first;
+            const int y1 = r.unk_begin()->second;
+            const int x2 = next(r.unk_begin())->first;
+            const int y2 = next(r.unk_begin())->second;
+
+            if (abs(x1 - x2) == 1 && abs(y1 - y2) == 1) {
+                pair<int, int> p;
+
+                if (r.contains(x1, y2)) {
+                    p = make_pair(x2, y1);
+                } else {
+                    p = make_pair(x1, y2);
+                }
+
+                // The far cell might already be black, in which case there's nothing to do.
+                // It could even be white/numbered (if it's part of this island), in which case
+                // there's still nothing to do.
+                // (If it's white/numbered and not part of this island,
+                // we'll eventually detect a contradiction.)
+
+                if (cell(p.first, p.second) == UNKNOWN) {
+                    mark_as_black.insert(p);
+                }
+            }
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white,
+        "N - 1 islands with exactly two diagonal liberties found.");
+}
+
+// Look for unreachable cells. They must be black.
+// This supersedes complete island analysis and forbidden bridge analysis.
+// (We run complete island analysis above because it's fast
+// and it makes the output easier to understand.)
+bool Grid::analyze_unreachable_cells(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (int x = 0; x < m_width; ++x) {
+        for (int y = 0; y < m_height; ++y) {
+            if (unreachable(x, y)) {
+                mark_as_black.insert(make_pair(x, y));
+            }
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white, "Unreachable cells blackened.");
+}
+
+// Look for squares of one unknown and three black cells, or two unknown and two black cells.
+bool Grid::analyze_potential_pools(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (int x = 0; x < m_width - 1; ++x) {
+        for (int y = 0; y < m_height - 1; ++y) {
+            struct XYState {
+                int x;
+                int y;
+                State state;
+            };
+
+            array<XYState, 4> a = { {
+                { x, y, cell(x, y) },
+                { x + 1, y, cell(x + 1, y) },
+                { x, y + 1, cell(x, y + 1) },
+                { x + 1, y + 1, cell(x + 1, y + 1) }
+            } };
+
+            static_assert(UNKNOWN < BLACK, "This code assumes that UNKNOWN < BLACK.");
+
+            sort(a.begin(), a.end(), [](const XYState& l, const XYState& r) {
+                return l.state < r.state;
+            });
+
+            if (a[0].state == UNKNOWN
+                && a[1].state == BLACK
+                && a[2].state == BLACK
+                && a[3].state == BLACK) {
+
+                mark_as_white.insert(make_pair(a[0].x, a[0].y));
+
+            } else if (a[0].state == UNKNOWN
+                && a[1].state == UNKNOWN
+                && a[2].state == BLACK
+                && a[3].state == BLACK) {
+
+                for (int i = 0; i < 2; ++i) {
+                    set<pair<int, int>> imagine_black;
+
+                    imagine_black.insert(make_pair(a[0].x, a[0].y));
+
+                    if (unreachable(a[1].x, a[1].y, imagine_black)) {
+                        mark_as_white.insert(make_pair(a[0].x, a[0].y));
+                    }
+
+                    std::swap(a[0], a[1]);
+                }
+            }
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white, "Whitened cells to prevent pools.");
+}
+
+// A region would be "confined" if it could not be completed.
+// Black regions need to consume m_total_black cells.
+// White regions need to escape to a number.
+// Numbered regions need to consume N cells.
+
+// Confinement analysis consists of imagining what would happen if a particular unknown cell
+// were black or white. If that would cause any region to be confined, the unknown cell
+// must be the opposite color.
+
+// Black cells can't confine black regions, obviously.
+// Black cells can confine white regions, by isolating them.
+// Black cells can confine numbered regions, by confining them to an insufficiently large space.
+
+// White cells can confine black regions, by confining them to an insufficiently large space.
+//   (Humans look for isolation here, i.e. permanently separated black regions.
+//   That's harder for us to detect, but counting cells is similarly powerful.)
+// White cells can't confine white regions.
+//   (This is true for freestanding white cells, white cells added to other white regions,
+//   and white cells added to numbered regions.)
+// White cells can confine numbered regions, when added to other numbered regions.
+//   This is the most complicated case to analyze. For example:
+//   ####3
+//   #6 xXx
+//   #.  x
+//   ######
+//   Imagining cell 'X' to be white additionally prevents region 6 from consuming
+//   three 'x' cells. (This is true regardless of what other cells region 3 would
+//   eventually occupy.)
+bool Grid::analyze_confinement(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    for (int x = 0; x < m_width; ++x) {
+        for (int y = 0; y < m_height; ++y) {
+            if (cell(x, y) == UNKNOWN) {
+                set<pair<int, int>> verboten;
+                verboten.insert(make_pair(x, y));
+
+                for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+                    const Region& r = **i;
+
+                    if (out_of_time(verbose)) {
+                        return true;
+                    }
+
+                    if (confined(*i, x + y * m_width, verboten)) {
+                        if (r.black()) {
+                            mark_as_black.insert(make_pair(x, y));
+                        } else {
+                            mark_as_white.insert(make_pair(x, y));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        const Region& r = **i;
+
+        if (r.numbered() && r.size() < r.number()) {
+            for (auto u = r.unk_begin(); u != r.unk_end(); ++u) {
+                set<pair<int, int>> verboten;
+                verboten.insert(*u);
+
+                insert_valid_unknown_neighbors(verboten, u->first, u->second);
+
+                for (auto k = m_regions.begin(); k != m_regions.end(); ++k) {
+                    if (out_of_time(verbose)) {
+                        return true;
+                    }
+
+                    if (k != i && (*k)->numbered()
+                        && confined(*k, CELL_AND_NEIGHBORS + u->first + u->second * m_width, verboten)) {
+                        mark_as_black.insert(*u);
+                    }
+                }
+            }
+        }
+    }
+
+    return process(verbose, mark_as_black, mark_as_white, "Confinement analysis succeeded.");
+}
+
+// Guess cells in a deterministic but pseudorandomized order.
+// This attempts to avoid repeatedly guessing cells that won't get us anywhere.
+// Prioritize guesses near white cells, which appears to be an especially good heuristic.
+// (In particular, it appears to be better than prioritizing guesses near white regions.)
+// Manhattan distance appears to work well; see http://en.wikipedia.org/wiki/Taxicab_geometry
+const vector<pair<int, int>>& Grid::guessing_order() {
+    // Find all unknown cells, and start the distance to the nearest white cell at 0 for the
+    // white cells themselves. The greatest possible Manhattan distance on the grid is
+    // m_width - 1 + m_height - 1, so we use m_width + m_height as an insanely large placeholder.
+    // The distance of cell (x, y) is at x * m_height + y.
+
+    const int far = m_width + m_height;
+
+    m_distance.assign(m_width * m_height, far);
+    m_unknowns.clear();
+
+    for (int x = 0; x < m_width; ++x) {
+        for (int y = 0; y < m_height; ++y) {
+            switch (cell(x, y)) {
+                case UNKNOWN:
+                    m_unknowns.push_back(make_pair(x, y));
+                    break;
+                case WHITE:
+                    m_distance[x * m_height + y] = 0;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    // Randomly shuffle the unknown cells.
+
+    auto dist = [this](const ptrdiff_t n) {
+        // random_shuffle() provides n > 0. It wants [0, n).
+        // uniform_int_distribution's ctor takes a and b with a <= b. It produces [a, b].
+        return uniform_int_distribution<ptrdiff_t>(0, n - 1)(m_prng);
+    };
+
+    random_shuffle(m_unknowns.begin(), m_unknowns.end(), dist);
+
+
+    // Determine the Manhattan distance from each cell to the nearest white cell.
+    // Nothing is in the way, so the nearest white cell is reached by going left or right
+    // and then up or down. The first pass finds the nearest white cell that's in the same column
+    // as each cell or to its left; the second pass considers the white cells to its right.
+
+    for (int x = 0; x < m_width; ++x) {
+        for (int y = 0; y < m_height; ++y) {
+            int& d = m_distance[x * m_height + y];
+
+            if (x > 0) {
+                d = min(d, m_distance[(x - 1) * m_height + y] + 1);
+            }
+
+            if (y > 0) {
+                d = min(d, m_distance[x * m_height + y - 1] + 1);
+            }
+        }
+
+        for (int y = m_height - 2; y >= 0; --y) {
+            int& d = m_distance[x * m_height + y];
+
+            d = min(d, m_distance[x * m_height + y + 1] + 1);
+        }
+    }
+
+    for (int x = m_width - 2; x >= 0; --x) {
+        for (int y = 0; y < m_height; ++y) {
+            int& d = m_distance[x * m_height + y];
+
+            d = min(d, m_distance[(x + 1) * m_height + y] + 1);
+        }
+    }
+
+
+    // Prioritize the unknown cells by the Manhattan distance to the nearest white cell.
+    // A counting sort is stable, so it avoids disrupting the random_shuffle() above.
+
+    m_counts.assign(far + 2, 0);
+
+    for (auto i = m_unknowns.begin(); i != m_unknowns.end(); ++i) {
+        ++m_counts[min(m_distance[i->first * m_height + i->second], far) + 1];
+    }
+
+    partial_sum(m_counts.begin(), m_counts.end(), m_counts.begin());
+
+    m_guessing_order.resize(m_unknowns.size());
+
+    for (auto i = m_unknowns.begin(); i != m_unknowns.end(); ++i) {
+        m_guessing_order[m_counts[min(m_distance[i->first * m_height + i->second], far)]++] = *i;
+    }
+
+    return m_guessing_order;
+}
+
+// Imagine that the cell at (x, y) is the given color, and solve without guessing until we're
+// stuck or cancelled() says that the answer is no longer needed. (In that case, return KEEP_GOING.)
+// The copy inherits the deadline, so this returns TIMED_OUT once it has expired.
+template <typename F> Grid::SitRep Grid::hypothetical(
+    const State color, const int x, const int y, F cancelled) const {
+
+    // Everything that other allocates is released at once, after other has been destroyed.
+
+    Arena::Scope scope;
+
+    Grid other(*this);
+
+    other.mark(color, x, y);
+
+    SitRep sr = KEEP_GOING;
+
+    while (sr == KEEP_GOING) {
+        if (cancelled()) {
+            return KEEP_GOING;
+        }
+
+        sr = other.solve(false, false);
+    }
+
+    return sr;
+}
+
+// Guess k is the cell v[k / 2], imagined to be black when k is even and white when k is odd.
+// Each worker takes the next guess in order, and gives up on any guess after the earliest one
+// that has succeeded so far. When the workers are done, the earliest success is the one that
+// sequential analysis would have found, because every guess before it must have failed.
+// Returns the index of that guess (or v.size() * 2 if every guess failed) and its SitRep.
+// If a guess runs out of time, every worker stops, and the guesses that were skipped might have
+// come before the earliest success, so the SitRep is TIMED_OUT and no guess is returned.
+int Grid::parallel_hypotheticals(const vector<pair<int, int>>& v, SitRep& sr) const {
+    const int guesses = static_cast<int>(v.size()) * 2;
+
+    atomic<int> next(0);
+    atomic<int> earliest(guesses);
+    atomic<bool> timed_out(false);
+    vector<SitRep> results(guesses, CANNOT_PROCEED);
+
+    mutex m;
+    exception_ptr error;
+
+    auto worker = [&]() {
+        try {
+            for (int k = next++; k < earliest && !timed_out; k = next++) {
+                const SitRep result = hypothetical(k % 2 == 0 ? BLACK : WHITE,
+                    v[k / 2].first, v[k / 2].second, [&]() { return earliest < k || timed_out; });
+
+                if (result == CONTRADICTION_FOUND
+                    || (result == SOLUTION_FOUND && m_options.assume_unique)) {
+                    results[k] = result;
+
+                    int e = earliest;
+
+                    while (k < e && !earliest.compare_exchange_weak(e, k)) { }
+                } else if (result == TIMED_OUT) {
+                    timed_out = true;
+                    break;
+                }
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(m);
+
+            if (!error) {
+                error = current_exception();
+            }
+
+            earliest = -1; // Stop everyone.
+        }
+    };
+
+    vector<thread> workers;
+
+    for (int i = 1; i < m_options.threads && i < guesses; ++i) {
+        workers.push_back(thread(worker));
+    }
+
+    worker();
+
+    for (auto i = workers.begin(); i != workers.end(); ++i) {
+        i->join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    if (timed_out) {
+        sr = TIMED_OUT;
+        return guesses;
+    }
+
+    const int k = earliest;
+
+    sr = k < guesses ? results[k] : CANNOT_PROCEED;
+
+    return k;
+}
+
+bool Grid::analyze_hypotheticals(const bool verbose) {
+    set<pair<int, int>> mark_as_black;
+    set<pair<int, int>> mark_as_white;
+
+    const vector<pair<int, int>>& v = guessing_order();
+    const int guesses = static_cast<int>(v.size()) * 2;
+
+    // Find the first guess, in guessing order, that leads to a contradiction or a solution
+    // (unless solutions can't be trusted).
+
+    int k = 0;
+    SitRep sr = CANNOT_PROCEED;
+
+    if (m_options.threads > 1) {
+        k = parallel_hypotheticals(v, sr);
+    } else {
+        for ( ; k < guesses; ++k) {
+            sr = hypothetical(k % 2 == 0 ? BLACK : WHITE, v[k / 2].first, v[k / 2].second,
+                []() { return false; });
+
+            if (sr == SOLUTION_FOUND && !m_options.assume_unique) {
+                continue;
+            }
+
+            if (sr != CANNOT_PROCEED) {
+                break;
+            }
+        }
+    }
+
+    if (sr == TIMED_OUT) {
+        if (verbose) {
+            print("I'm out of time!");
+        }
+
+        m_sitrep = TIMED_OUT;
+        return true;
+    }
+
+    if (k == guesses) {
+        return false;
+    }
+
+    // Every guess before k failed (CANNOT_PROCEED), which covers the cells before v[k / 2],
+    // and v[k / 2] itself if its black guess failed before its white guess was tried.
+
+    const int failed_guesses = k;
+    const set<pair<int, int>> failed_coords(v.begin(), v.begin() + (k + 1) / 2);
+
+    const pair<int, int> p = v[k / 2];
+    auto& mark_as_diff = k % 2 == 0 ? mark_as_white : mark_as_black;
+    auto& mark_as_same = k % 2 == 0 ? mark_as_black : mark_as_white;
+
+    if (sr == CONTRADICTION_FOUND) {
+        mark_as_diff.insert(p);
+        return process(verbose, mark_as_black, mark_as_white,
+            "Hypothetical contradiction found.", failed_guesses, failed_coords);
+    }
+
+    // sr == SOLUTION_FOUND
+    mark_as_same.insert(p);
+    return process(verbose, mark_as_black, mark_as_white,
+        "Hypothetical solution found.", failed_guesses, failed_coords);
+}
+
+void Grid::set_trace(Trace * const trace) {
+    m_trace = trace;
+}
+
+// Check the deadline during analysis. Once it has expired, the step that's checking gives up,
+// leaving the board as it is, and solve() returns TIMED_OUT.
+bool Grid::out_of_time(const bool verbose) {
+    if (!m_options.deadline.expired()) {
+        return false;
+    }
+
+    if (verbose) {
+        print("I'm out of time!");
+    }
+
+    m_sitrep = TIMED_OUT;
+    return true;
+}
+
+// Record that we're starting a step of analysis.
+bool Grid::trace(const char * const label) {
+    if (m_trace) {
+        m_trace->record(label);
+    }
+
+    return false;
+}
+
+int Grid::known() const {
+    int ret = 0;
+
+    for (int x = 0; x < m_width; ++x) {
+        for (int y = 0; y < m_height; ++y) {
+            if (cell(x, y) != UNKNOWN) {
+                ++ret;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void Grid::write(ostream& os, const Clock::time_point start, const Clock::time_point finish) const {
+    OutputBuffer out(os);
+
+    out <<
+        "<!DOCTYPE html>\n"
+        "<html>\n"
+        "  <head>\n"
+        "    <meta http-equiv=\"Content-Type\" content=\"text/html;charset=utf-8\" />\n"
+        "    <style type=\"text/css\">\n"
+        "      body {\n"
+        "        font-family: Verdana, sans-serif;\n"
+        "        line-height: 1.4;\n"
+        "      }\n"
+        "      table {\n"
+        "        border: solid 3px #000000;\n"
+        "        border-collapse: collapse;\n"
+        "      }\n"
+        "      td {\n"
+        "        border: solid 1px #000000;\n"
+        "        text-align: center;\n"
+        "        width: 20px;\n"
+        "        height: 20px;\n"
+        "      }\n"
+        "      td.unknown   { background-color: #C0C0C0; }\n"
+        "      td.white.new { background-color: #FFFF00; }\n"
+        "      td.white.old { }\n"
+        "      td.black.new { background-color: #008080; }\n"
+        "      td.black.old { background-color: #808080; }\n"
+        "      td.number    { }\n"
+        "      td.failed    { border: solid 3px #000000; }\n"
+        "    </style>\n"
+        "    <title>Nurikabe</title>\n"
+        "  </head>\n"
+        "  <body>\n";
+
+    Clock::time_point old_ctr = start;
+
+    // Recordings of changes are replayed onto a board that starts out unknown.
+
+    vector<vector<State>> board(m_width, vector<State>(m_height, UNKNOWN));
+
+    // Each step's updated and failed cells are flagged here while it's being written.
+
+    enum : unsigned char { NEW = 1, FAILED = 2 };
+
+    vector<unsigned char> flags(m_width * m_height, 0);
+
+    for (auto i = m_output.begin(); i != m_output.end(); ++i) {
+        const string& s = i->message;
+        const auto& updated = i->updated;
+        const Clock::time_point ctr = i->time;
+        const int failed_guesses = i->failed_guesses;
+        const auto& failed_coords = i->failed_coords;
+
+        for (auto k = i->changes.begin(); k != i->changes.end(); ++k) {
+            board[get<0>(*k)][get<1>(*k)] = get<2>(*k);
+        }
+
+        const auto& v = i->board.empty() ? board : i->board;
+
+        for (auto k = updated.begin(); k != updated.end(); ++k) {
+            flags[k->first * m_height + k->second] |= NEW;
+        }
+
+        for (auto k = failed_coords.begin(); k != failed_coords.end(); ++k) {
+            flags[k->first * m_height + k->second] |= FAILED;
+        }
+
+        out << s << " (" << format_time(ctr - old_ctr) << ")\n";
+
+        if (failed_guesses == 1) {
+            out << "<br/>1 guess failed.\n";
+        } else if (failed_guesses > 0) {
+            out << "<br/>" << failed_guesses << " guesses failed.\n";
+        }
+
+        old_ctr = ctr;
+
+        out << "<table>\n";
+
+        for (int y = 0; y < m_height; ++y) {
+            out << "<tr>";
+
+            for (int x = 0; x < m_width; ++x) {
+                const unsigned char f = flags[x * m_height + y];
+
+                out << "<td class=\"";
+                out << ((f & NEW) != 0 ? "new " : "old ");
+
+                if ((f & FAILED) != 0) {
+                    out << "failed ";
+                }
+
+                switch (v[x][y]) {
+                    case UNKNOWN: out << "unknown\"> ";           break;
+                    case WHITE:   out <<   "white\">.";           break;
+                    case BLACK:   out <<   "black\">#";           break;
+                    default:      out <<  "number\">" << v[x][y]; break;
+                }
+
+                out << "</td>";
+            }
+
+            out << "</tr>\n";
+        }
+
+        out << "</table><br/>\n";
+
+        for (auto k = updated.begin(); k != updated.end(); ++k) {
+            flags[k->first * m_height + k->second] = 0;
+        }
+
+        for (auto k = failed_coords.begin(); k != failed_coords.end(); ++k) {
+            flags[k->first * m_height + k->second] = 0;
+        }
+    }
+
+    out << "Total: " << format_time(finish - start) << "\n";
+
+    out <<
+        "  </body>\n"
+        "</html>\n";
+}
+
+vector<string> Grid::rows() const {
+    vector<string> ret(m_height);
+
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            switch (cell(x, y)) {
+                case UNKNOWN: ret[y] += ' ';                    break;
+                case WHITE:   ret[y] += '.';                    break;
+                case BLACK:   ret[y] += '#';                    break;
+                default:      ret[y] += to_string(cell(x, y));  break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void Grid::write_packed(ostream& os) const {
+    NibbleWriter out(m_width, m_height);
+
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            switch (cell(x, y)) {
+                case UNKNOWN: out.push(0);                   break;
+                case WHITE:   out.push(14);                  break;
+                case BLACK:   out.push(15);                  break;
+                default:      out.push_number(cell(x, y));   break;
+            }
+        }
+    }
+
+    out.write(os);
+}
+
+void Grid::write_json(ostream& os, const string& name,
+    const Clock::time_point start, const Clock::time_point finish) const {
+
+    OutputBuffer out(os);
+
+    out << "{\"name\":";
+    out.json_string(name);
+    out << ",\"width\":" << m_width << ",\"height\":" << m_height
+        << ",\"known\":" << known()
+        << ",\"nanoseconds\":" << static_cast<long long>((finish - start).count())
+        << ",\"board\":[";
+
+    const vector<string> r = rows();
+
+    for (auto i = r.begin(); i != r.end(); ++i) {
+        out << (i == r.begin() ? "" : ",");
+        out.json_string(*i);
+    }
+
+    out << "],\"steps\":[";
+
+    Clock::time_point old_ctr = start;
+
+    for (auto i = m_output.begin(); i != m_output.end(); ++i) {
+        out << (i == m_output.begin() ? "{\"message\":" : ",{\"message\":");
+        out.json_string(i->message);
+        out << ",\"nanoseconds\":" << static_cast<long long>((i->time - old_ctr).count())
+            << ",\"failed_guesses\":" << i->failed_guesses << '}';
+
+        old_ctr = i->time;
+    }
+
+    out << "]}\n";
+}
+
+bool Grid::valid(const int x, const int y) const {
+    return x >= 0 && x < m_width && y >= 0 && y < m_height;
+}
+
+Grid::State& Grid::cell(const int x, const int y) {
+    return m_cells[x][y].first;
+}
+
+const Grid::State& Grid::cell(const int x, const int y) const {
+    return m_cells[x][y].first;
+}
+
+shared_ptr<Grid::Region>& Grid::region(const int x, const int y) {
+    return m_cells[x][y].second;
+}
+
+const shared_ptr<Grid::Region>& Grid::region(const int x, const int y) const {
+    return m_cells[x][y].second;
+}
+
+void Grid::record_change(const int x, const int y) {
+    if (m_options.recording == RECORD_DELTAS) {
+        m_changes.push_back(make_tuple(x, y, cell(x, y)));
+    }
+}
+
+void Grid::print(const string& s, const set<pair<int, int>>& updated,
+    const int failed_guesses, const set<pair<int, int>>& failed_coords) {
+
+    if (m_options.recording == RECORD_NOTHING) {
+        return;
+    }
+
+    Step step;
+
+    step.message = s;
+
+    if (m_options.recording == RECORD_BOARDS) {
+        step.board.assign(m_width, vector<State>(m_height));
+
+        for (int x = 0; x < m_width; ++x) {
+            for (int y = 0; y < m_height; ++y) {
+                step.board[x][y] = cell(x, y);
+            }
+        }
+    } else {
+        step.changes.swap(m_changes);
+    }
+
+    step.updated = updated;
+    step.time = Clock::now();
+    step.failed_guesses = failed_guesses;
+    step.failed_coords = failed_coords;
+
+    m_output.push_back(move(step));
+}
+
+bool Grid::process(const bool verbose, const set<pair<int, int>>& mark_as_black,
+    const set<pair<int, int>>& mark_as_white, const string& s,
+    const int failed_guesses, const set<pair<int, int>>& failed_coords) {
+
+    if (mark_as_black.empty() && mark_as_white.empty()) {
+        return false;
+    }
+
+    for (auto i = mark_as_black.begin(); i != mark_as_black.end(); ++i) {
+        mark(BLACK, i->first, i->second);
+    }
+
+    for (auto i = mark_as_white.begin(); i != mark_as_white.end(); ++i) {
+        mark(WHITE, i->first, i->second);
+    }
+
+    if (verbose) {
+        set<pair<int, int>> updated(mark_as_black);
+        updated.insert(mark_as_white.begin(), mark_as_white.end());
+
+        string t = s;
+
+        if (m_sitrep == CONTRADICTION_FOUND) {
+            t += " (Contradiction found! Attempted to fuse two numbered regions"
+                " or mark an already known cell.)";
+        }
+
+        print(t, updated, failed_guesses, failed_coords);
+    }
+
+    return true;
+}
+
+template <typename F> void Grid::for_valid_neighbors(const int x, const int y, F f) const {
+    if (x > 0) {
+        f(x - 1, y);
+    }
+
+    if (x + 1 < m_width) {
+        f(x + 1, y);
+    }
+
+    if (y > 0) {
+        f(x, y - 1);
+    }
+
+    if (y + 1 < m_height) {
+        f(x, y + 1);
+    }
+}
+
+void Grid::insert_valid_neighbors(set<pair<int, int>>& s, const int x, const int y) const {
+    for_valid_neighbors(x, y, [&](const int a, const int b) {
+        s.insert(make_pair(a, b));
+    });
+}
+
+void Grid::insert_valid_unknown_neighbors(set<pair<int, int>>& s, const int x, const int y) const {
+    for_valid_neighbors(x, y, [&](const int a, const int b) {
+        if (cell(a, b) == UNKNOWN) {
+            s.insert(make_pair(a, b));
+        }
+    });
+}
+
+void Grid::add_region(const int x, const int y) {
+    // Construct a region, then add it to the cell and the set of all regions.
+
+    CellSet unknowns(m_width, m_height);
+
+    for_valid_neighbors(x, y, [&](const int a, const int b) {
+        if (cell(a, b) == UNKNOWN) {
+            unknowns.insert(a, b);
+        }
+    });
+
+    auto r = allocate_shared<Region>(ArenaAllocator<Region>(), cell(x, y), x, y, unknowns);
+
+    region(x, y) = r;
+
+    m_regions.insert(r);
+}
+
+void Grid::mark(const State s, const int x, const int y) {
+    if (s != WHITE && s != BLACK) {
+        throw logic_error("LOGIC ERROR: Grid::mark() - s must be either WHITE or BLACK.");
+    }
+
+    // If we're asked to mark an already known cell, we've encountered a contradiction.
+    // Remember this, so that solve() can report the contradiction.
+
+    if (cell(x, y) != UNKNOWN) {
+        m_sitrep = CONTRADICTION_FOUND;
+        return;
+    }
+
+    // Set the cell's new state. Because it's now known,
+    // update each region's set of surrounding unknown cells.
+
+    cell(x, y) = s;
+
+    record_change(x, y);
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        (*i)->unk_erase(x, y);
+    }
+
+    // Marking a cell as white or black could create an independent region,
+    // could be added to an existing region, or could connect 2, 3, or 4 separate regions.
+    // The easiest thing to do is to create a region for this cell,
+    // and then fuse it to any adjacent compatible regions.
+
+    add_region(x, y);
+
+    // Don't attempt to cache these regions.
+    // Each fusion could change this cell's region or its neighbors' regions.
+
+    for_valid_neighbors(x, y, [this, x, y](const int a, const int b) {
+        fuse_regions(region(x, y), region(a, b));
+    });
+
+    // Every cell whose region has changed is now in this cell's region.
+
+    invalidate_confinement(*region(x, y));
+}
+
+// Throw away the confinement results that depended on any of the changed region's cells.
+void Grid::invalidate_confinement(const Region& changed) {
+    for (auto i = m_confinement.begin(); i != m_confinement.end(); ) {
+        if (i->second.touched.intersects(changed.coords())) {
+            i = m_confinement.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Note that r1 and r2 are passed by modifiable value. It's convenient to be able to swap them.
+void Grid::fuse_regions(shared_ptr<Region> r1, shared_ptr<Region> r2) {
+
+    // If we don't have two different regions, we're done.
+
+    if (!r1 || !r2 || r1 == r2) {
+        return;
+    }
+
+    // If we're asked to fuse two numbered regions, we've encountered a contradiction.
+    // Remember this, so that solve() can report the contradiction.
+
+    if (r1->numbered() && r2->numbered()) {
+        m_sitrep = CONTRADICTION_FOUND;
+        return;
+    }
+
+    // Black regions can't be fused with non-black regions.
+
+    if (r1->black() != r2->black()) {
+        return;
+    }
+
+    // We'll use r1 as the "primary" region, to which r2's cells are added.
+    // It would be efficient to process as few cells as possible.
+    // Therefore, we'd like to use the bigger region as the primary region.
+
+    if (r2->size() > r1->size()) {
+        std::swap(r1, r2);
+    }
+
+    // However, if the secondary region is numbered, then the primary region
+    // must be white, so we need to swap them, even if the numbered region is smaller.
+
+    if (r2->numbered()) {
+        std::swap(r1, r2);
+    }
+
+    // Fuse the secondary region into the primary region.
+
+    r1->insert(*r2);
+    r1->unk_insert(*r2);
+
+    // Update the secondary region's cells to point to the primary region.
+
+    for (auto i = r2->begin(); i != r2->end(); ++i) {
+        region(i->first, i->second) = r1;
+    }
+
+    // Erase the secondary region from the set of all regions.
+    // When this function returns, the secondary region will be destroyed.
+
+    m_regions.erase(r2);
+}
+
+bool Grid::impossibly_big_white_region(const int n) const {
+    // A white region of N cells is impossibly big
+    // if it could never be connected to any numbered region.
+
+    return none_of(m_regions.begin(), m_regions.end(),
+        [n](const shared_ptr<Region>& p) {
+            // Add one because a bridge would be needed.
+            return p->numbered() && p->size() + n + 1 <= p->number();
+        });
+}
+
+// The cell at (x_root, y_root) is unreachable if it is unknown
+// and it cannot be connected to a numbered region or a white region.
+// An unknown cell completely surrounded by black cells is obviously unreachable,
+// but because unreachability takes distance into account, it is considerably more powerful.
+// We use a breadth-first search to discover the shortest path from the root to a numbered region
+// or a white region. (Essentially, we're imagining a chain of white cells starting from the root.)
+// We refuse to consider stepping anywhere that would join two numbered regions.
+// Additionally, while we want to connect to a numbered region, we can't create a region that's
+// too big for its number. (We'll add up the number of white cells that it took us to get from
+// the root to the potential connection point, the current size of the numbered region,
+// and the sizes of any white regions (up to 2) that would also be connected.)
+// Finally, while we'd like to connect to a white region, we can't create
+// an impossibly big white region.
+// Note that this supersedes complete island analysis and forbidden bridge analysis.
+// The "discovered" parameter can be used to tell unreachable() to avoid stepping on a cell.
+// This is used when identifying squares of two unknown and two black cells;
+// if imagining cell A to be black makes cell B unreachable, then cell A must be white.
+bool Grid::unreachable(const int x_root, const int y_root, set<pair<int, int>> discovered) const {
+
+    // We're interested in unknown cells.
+
+    if (cell(x_root, y_root) != UNKNOWN) {
+        return false;
+    }
+
+    // See http://en.wikipedia.org/wiki/Breadth-first_search
+
+    queue<tuple<int, int, int>> q;
+
+    q.push(make_tuple(x_root, y_root, 1));
+    discovered.insert(make_pair(x_root, y_root));
+
+    while (!q.empty()) {
+        const int x_curr = get<0>(q.front());
+        const int y_curr = get<1>(q.front());
+        const int n_curr = get<2>(q.front());
+        q.pop();
+
+        set<shared_ptr<Region>> white_regions;
+        set<shared_ptr<Region>> numbered_regions;
+
+        for_valid_neighbors(x_curr, y_curr, [&](const int x, const int y) {
+            const shared_ptr<Region>& r = region(x, y);
+
+            if (r && r->white()) {
+                white_regions.insert(r);
+            } else if (r && r->numbered()) {
+                numbered_regions.insert(r);
+            }
+        });
+
+        int size = 0;
+
+        for (auto i = white_regions.begin(); i != white_regions.end(); ++i) {
+            size += (*i)->size();
+        }
+
+        for (auto i = numbered_regions.begin(); i != numbered_regions.end(); ++i) {
+            size += (*i)->size();
+        }
+
+        if (numbered_regions.size() > 1) {
+            continue;
+        }
+
+        if (numbered_regions.size() == 1) {
+            const int num = (*numbered_regions.begin())->number();
+
+            if (n_curr + size <= num) {
+                return false;
+            } else {
+                continue;
+            }
+        }
+
+        if (!white_regions.empty()) {
+            if (impossibly_big_white_region(n_curr + size)) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+
+        for_valid_neighbors(x_curr, y_curr, [&](const int x, const int y) {
+            if (cell(x, y) == UNKNOWN && discovered.insert(make_pair(x, y)).second) {
+                q.push(make_tuple(x, y, n_curr + 1));
+            }
+        });
+    }
+
+    return true;
+}
+
+namespace {
+    // This explicitly specified underlying type significantly increases performance.
+    enum Flag : unsigned char {
+        NONE,
+        OPEN,
+        CLOSED,
+        VERBOTEN
+    };
+}
+
+// Is r confined, assuming that we can't consume verboten cells?
+// Results are cached under key, which must identify the verboten cells.
+bool Grid::confined(const shared_ptr<Region>& r, const int key,
+    const set<pair<int, int>>& verboten) {
+
+    // When we look for contradictions, we run confinement analysis (A) without verboten cells.
+    // This gives us an opportunity to accelerate later confinement analysis (B)
+    // when we have verboten cells.
+    // During A, we'll record the unknown cells that we consumed.
+    // During B, if none of the verboten cells are ones that we consumed,
+    // then the verboten cells can't confine us.
+
+    if (!verboten.empty()) {
+        if (m_confinement.find(make_pair(r, static_cast<int>(NO_VERBOTEN))) == m_confinement.end()) {
+            confined(r);
+        }
+
+        const auto& consumed = m_confinement.find(make_pair(r, static_cast<int>(NO_VERBOTEN)))->second.consumed;
+
+        if (none_of(verboten.begin(), verboten.end(), [&](const pair<int, int>& p) {
+            return consumed.contains(p.first, p.second);
+        })) {
+            return false;
+        }
+    }
+
+    const auto i = m_confinement.find(make_pair(r, key));
+
+    if (i != m_confinement.end()) {
+        return i->second.confined;
+    }
+
+    Confinement c(false, CellSet(m_width, m_height));
+
+    c.confined = flood_confined(r, verboten, c.consumed, c.touched);
+
+    m_confinement.insert(make_pair(make_pair(r, key), c));
+
+    return c.confined;
+}
+
+// Is r confined, assuming that we can't consume verboten cells? This does the work for confined(),
+// additionally recording the unknown cells that we consumed (without verboten cells) and every cell
+// that the answer depends on.
+bool Grid::flood_confined(const shared_ptr<Region>& r, const set<pair<int, int>>& verboten,
+    CellSet& consumed, CellSet& touched) const {
+
+    // The answer depends on r and the verboten cells, and on every cell that we consider below.
+
+    touched.insert(r->coords());
+    touched.insert(r->unknowns());
+
+    for (auto i = verboten.begin(); i != verboten.end(); ++i) {
+        touched.insert(i->first, i->second);
+    }
+
+    vector<Flag> flags(m_width * m_height, NONE);
+
+    // Finding the first open flag by scanning the flags made each step linear in the size of the
+    // grid. So we also keep a bit for each flag that has been set to OPEN, and clear it when we
+    // find that the flag has been overwritten or when we consider the cell.
+    vector<unsigned long long> open((m_width * m_height + 63) / 64, 0);
+
+    auto set_open = [&](const int index) {
+        flags[index] = OPEN;
+        open[index / 64] |= 1ULL << (index % 64);
+    };
+
+    auto first_open = [&]() -> int {
+        for (size_t w = 0; w < open.size(); ++w) {
+            while (open[w] != 0) {
+                const unsigned long long word = open[w];
+                const int index = static_cast<int>(w * 64 + bitset<64>((word & (0 - word)) - 1).count());
+
+                open[w] &= word - 1;
+
+                if (flags[index] == OPEN) {
+                    return index;
+                }
+            }
+        }
+
+        return -1;
+    };
+
+    // The open set contains cells that we're considering adding to the region.
+    for (auto i = r->unk_begin(); i != r->unk_end(); ++i) {
+        set_open(i->first + i->second * m_width);
+    }
+
+    // The closed set contains cells that we've hypothetically added to the region.
+    for (auto i = r->begin(); i != r->end(); ++i) {
+        flags[i->first + i->second * m_width] = CLOSED;
+    }
+
+    int closed_size = r->size();
+
+    // Flag the verboten cells last, because this could overwrite open flags.
+    for (auto i = verboten.begin(); i != verboten.end(); ++i) {
+        flags[i->first + i->second * m_width] = VERBOTEN;
+    }
+
+    // While we need to consume more cells...
+    while (r->black() && closed_size < m_total_black
+        || r->white()
+        || r->numbered() && closed_size < r->number()) {
+
+        // Do we have a cell to consider?
+
+        const int index = first_open();
+
+        if (index < 0) {
+            break; // We don't.
+        }
+
+        flags[index] = NONE;
+
+        const pair<int, int> p(index % m_width, index / m_width);
+
+        // Consider cell p.
+
+        touched.insert(p.first, p.second);
+
+        // We need to compare our region r with p's region (if any).
+        const auto& area = region(p.first, p.second);
+
+        if (r->black()) {
+            if (!area) {
+                // Keep going. A black region can consume an unknown cell.
+            } else if (area->black()) {
+                // Keep going. A black region can consume another black region.
+            } else { // area->white() || area->numbered()
+                continue; // We can't consume this. Discard it.
+            }
+        } else if (r->white()) {
+            if (!area) {
+                // Keep going. A white region can consume an unknown cell.
+            } else if (area->black()) {
+                continue; // We can't consume this. Discard it.
+            } else if (area->white()) {
+                // Keep going. A white region can consume another white region.
+            } else { // area->numbered()
+                return false; // Yay! Our region r escaped to a numbered region.
+            }
+        } else { // r->numbered()
+            if (!area) {
+                // A numbered region can't consume an unknown cell
+                // that's adjacent to another numbered region.
+                bool rejected = false;
+
+                for_valid_neighbors(p.first, p.second, [&](const int a, const int b) {
+                    const auto& other = region(a, b);
+
+                    touched.insert(a, b);
+
+                    if (other && other->numbered() && other != r) {
+                        rejected = true;
+                    }
+                });
+
+                if (rejected) {
+                    continue;
+                }
+
+                // Keep going. This unknown cell is okay to consume.
+            } else if (area->black()) {
+                continue; // We can't consume this. Discard it.
+            } else if (area->white()) {
+                // Keep going. A numbered region can consume a white region.
+            } else { // area->numbered()
+                throw logic_error("LOGIC ERROR: Grid::confined() - "
+                    "I was confused and thought two numbered regions would be adjacent.");
+            }
+        }
+
+        if (!area) { // Consume an unknown cell.
+            flags[p.first + p.second * m_width] = CLOSED;
+            ++closed_size;
+
+            for_valid_neighbors(p.first, p.second, [&](const int a, const int b) {
+                if (flags[a + b * m_width] == NONE) {
+                    set_open(a + b * m_width);
+                }
+            });
+
+            if (verboten.empty()) {
+                consumed.insert(p.first, p.second);
+            }
+        } else { // Consume a whole region.
+            for (auto i = area->begin(); i != area->end(); ++i) {
+                flags[i->first + i->second * m_width] = CLOSED;
+            }
+
+            closed_size += area->size();
+
+            touched.insert(area->coords());
+            touched.insert(area->unknowns());
+
+            for (auto i = area->unk_begin(); i != area->unk_end(); ++i) {
+                if (flags[i->first + i->second * m_width] == NONE) {
+                    set_open(i->first + i->second * m_width);
+                }
+            }
+        }
+    }
+
+    // We're confined if we still need to consume more cells.
+    return r->black() && closed_size < m_total_black
+        || r->white()
+        || r->numbered() && closed_size < r->number();
+}
+
+bool Grid::detect_contradictions(const bool verbose) {
+    auto uh_oh = [&](const string& s) -> bool {
+        if (verbose) {
+            print(s);
+        }
+
+        m_sitrep = CONTRADICTION_FOUND;
+
+        return true;
+    };
+
+    for (int x = 0; x < m_width - 1; ++x) {
+        for (int y = 0; y < m_height - 1; ++y) {
+            if (cell(x, y) == BLACK
+                && cell(x + 1, y) == BLACK
+                && cell(x, y + 1) == BLACK
+                && cell(x + 1, y + 1) == BLACK) {
+
+                return uh_oh("Contradiction found! Pool detected.");
+            }
+        }
+    }
+
+    int black_cells = 0;
+    int white_cells = 0;
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        const Region& r = **i;
+
+        // We don't need to look for gigantic black regions because
+        // counting black cells is strictly more powerful.
+
+        if (r.white() && impossibly_big_white_region(r.size())
+            || r.numbered() && r.size() > r.number()) {
+
+            return uh_oh("Contradiction found! Gigantic region detected.");
+        }
+
+        (r.black() ? black_cells : white_cells) += r.size();
+
+
+        if (confined(*i)) {
+            return uh_oh("Contradiction found! Confined region detected.");
+        }
+    }
+
+    if (black_cells > m_total_black) {
+        return uh_oh("Contradiction found! Too many black cells detected.");
+    }
+
+    if (white_cells > m_width * m_height - m_total_black) {
+        return uh_oh("Contradiction found! Too many white/numbered cells detected.");
+    }
+
+    return false;
+}
+
+Grid::Grid(const Grid& other)
+    : m_width(other.m_width),
+    m_height(other.m_height),
+    m_total_black(other.m_total_black),
+    m_cells(other.m_cells),
+    m_regions(),
+    m_sitrep(other.m_sitrep),
+    m_output(), // Intentionally not copied to increase performance. This copy ctor is private.
+    m_changes(),
+    m_prng(other.m_prng),
+    m_options(other.m_options),
+    m_confinement(),
+    m_trace(nullptr),
+    m_distance(),
+    m_unknowns(),
+    m_counts(),
+    m_guessing_order() {
+
+    // Hypothetical grids are never written, so they don't record anything.
+
+    m_options.recording = RECORD_NOTHING;
+
+    map<shared_ptr<Region>, shared_ptr<Region>> copies;
+
+    for (auto i = other.m_regions.begin(); i != other.m_regions.end(); ++i) {
+        const auto r = allocate_shared<Region>(ArenaAllocator<Region>(), **i);
+
+        m_regions.insert(r);
+
+        if (m_options.copy_confinement) {
+            copies.insert(make_pair(*i, r));
+        }
+    }
+
+    // The cached results are keyed by region, so they have to be rekeyed by our copies.
+
+    for (auto i = other.m_confinement.begin(); m_options.copy_confinement && i != other.m_confinement.end(); ++i) {
+        const auto k = copies.find(i->first.first);
+
+        if (k != copies.end()) {
+            m_confinement.insert(make_pair(make_pair(k->second, i->first.second), i->second));
+        }
+    }
+
+    for (auto i = m_regions.begin(); i != m_regions.end(); ++i) {
+        for (auto k = (*i)->begin(); k != (*i)->end(); ++k) {
+            region(k->first, k->second) = *i;
+        }
+    }
+}
+
+} // namespace nurikabe
@@ -19,13 +19,31 @@
 #include "stdafx.h"
 #include "Cell.h"
 #include "Grid.h"
-#include <fstream>
+#include "Solver.h"
+#include "Server.h"
+#include "Parallel.h"
+#include "MappedFile.h"
+#include "PuzzleReader.h"
+#include "PackedGrid.h"
+#include "Canonical.h"
+#include "BatchSweep.h"
+#include "Generator.h"
+#include <cstdio>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#if defined( _WIN32 )
+#include <fcntl.h>
+#include <io.h>
+#endif
 
-bool solve( Grid& grid )
-{
-  return grid.solve() || grid.solve_by_guessing();
-}
+// grids are read, solved and printed this many at a time, so memory use doesn't grow with the file
+const std::size_t BATCH_SIZE = 65536;
+
+// results kept for repeated puzzles, by canonical form. The cache is emptied when it reaches
+// CACHE_SIZE entries, so memory use doesn't grow with the file either
+typedef std::unordered_map<std::string, SolveResult> SolveCache;
+const std::size_t CACHE_SIZE = 1 << 20;
 
 int euler_number_calc( Grid grid )
 {
@@ -35,36 +53,224 @@ int euler_number_calc( Grid grid )
           ( euler_values[2]       );
 }
 
-int _tmain(int argc, _TCHAR* argv[])
+// the formats that grids are read and written in: text, read by PuzzleReader and printed cell by cell,
+// or PackedGrid's records
+enum Format
+{
+  TEXT,
+  PACKED
+};
+
+// GridReader
+// reads grids from a mapped file in either format
+
+class GridReader
+{
+public:
+  GridReader( MappedFile& file, Format format ) : m_text( file ), m_packed( file ), m_format( format )
+  {
+  }
+
+  bool
+  next( Grid& grid )
+  {
+    return m_format == PACKED ? m_packed.next( grid ) : m_text.next( grid );
+  }
+
+private:
+  MappedReader<PuzzleReader> m_text;
+  MappedReader<PackedReader> m_packed;
+  Format                     m_format;
+};
+
+// binary output
+// puts standard output in binary mode, for packed records, so that no byte is taken for a line ending
+//
+//@param nothing
+//@return nothing
+void binary_output()
+{
+#if defined( _WIN32 )
+  _setmode( _fileno( stdout ), _O_BINARY );
+#endif
+}
+
+// write line
+// a grid as one line of NUM_CELLS digits, '0' for a cell that isn't solved, which PuzzleReader reads back
+//
+//@param stream, grid
+//@return nothing
+void write_line( std::ostream& out, const Grid& grid )
+{
+  char line[Grid::NUM_CELLS + 1];
+  for ( int cell_index = 0; cell_index < Grid::NUM_CELLS; ++cell_index )
+  {
+    const Cell& analysed_cell = grid.get_cells()[cell_index];
+    line[cell_index] = static_cast<char>( '0' + ( analysed_cell.solved() ? analysed_cell.get_solution() : 0 ));
+  }
+  line[Grid::NUM_CELLS] = '\n';
+  out.write( line, sizeof( line ));
+}
+
+// read grids
+// reads grids until max_grids have been read or the input ends
+//
+//@param reader over the input, grids read, maximum number to read
+//@return number of grids read
+std::size_t read_grids( GridReader& reader, std::vector<Grid>& grids, std::size_t max_grids )
+{
+  grids.clear();
+  Grid grid;
+  while ( grids.size() < max_grids && reader.next( grid ))
+  {
+    grids.push_back( grid );
+  }
+  return grids.size();
+}
+
+// solve batch
+// solves a batch of grids through the cache. Each grid is brought to canonical form, shared between the
+// solver's threads, and one that is equivalent to a grid already solved, in this batch or an earlier one,
+// has that result mapped back to it instead of being solved again. The rest are solved in canonical form
+// in one solve_all(). Only finished results are kept: a grid whose form timed out, or never started, is
+// solved again on its own, as the next copy may well have the time to finish.
+//
+//@param the solver, the grids, the cache
+//@return a result for each grid, in order
+std::vector<SolveResult> solve_batch( const Solver& solver, const std::vector<Grid>& grids, SolveCache& cache )
 {
   using namespace std;
 
-  if ( argc != 2 )
+  const int threads = solver.options().threads;
+  vector<Canonical> forms( grids.size() );
+  parallel_for( grids.size(), threads, [&]( size_t i )
   {
-    cout << "Usage: sudoku <file>" << endl;
-    return 1;
+    forms[i] = Canonical( grids[i] );
+  });
+  if ( cache.size() + grids.size() > CACHE_SIZE )
+  {
+    cache.clear();
+  }
+
+  // the first grid with each new form is solved, and the others wait for its result. Each grid's result
+  // comes from the cache, or from that solve, by the position of the grid's form in it
+  vector<Grid>   unsolved;
+  vector<size_t> unsolved_first;
+  unordered_map<string, size_t> pending;
+  vector<const SolveResult*> cached( grids.size(), 0 );
+  vector<size_t> position( grids.size(), 0 );
+  for ( size_t i = 0; i < grids.size(); ++i )
+  {
+    const auto found = cache.find( forms[i].key() );
+    if ( found != cache.end() )
+    {
+      cached[i] = &found->second;
+      continue;
+    }
+    const auto waiting = pending.insert( make_pair( forms[i].key(), unsolved.size() ));
+    if ( waiting.second )
+    {
+      unsolved.push_back( forms[i].canonical_grid() );
+      unsolved_first.push_back( i );
+    }
+    position[i] = waiting.first->second;
+  }
+  const vector<SolveResult> solved = solver.solve_all( unsolved );
+
+  // the copies of a form that didn't finish are solved as they are, each with its own time
+  auto shares = [&]( size_t i )
+  {
+    return cached[i] != 0 || unsolved_first[position[i]] == i || solved[position[i]].finished();
+  };
+  vector<SolveResult> results( grids.size() );
+  vector<Grid>   again;
+  vector<size_t> again_index;
+  for ( size_t i = 0; i < grids.size(); ++i )
+  {
+    if ( !shares( i ))
+    {
+      again.push_back( grids[i] );
+      again_index.push_back( i );
+    }
+  }
+  const vector<SolveResult> resolved = solver.solve_all( again );
+  for ( size_t i = 0; i < resolved.size(); ++i )
+  {
+    results[again_index[i]] = resolved[i];
+  }
+
+  parallel_for( grids.size(), threads, [&]( size_t i )
+  {
+    if ( shares( i ))
+    {
+      const SolveResult& result = cached[i] ? *cached[i] : solved[position[i]];
+      results[i]      = result;
+      results[i].grid = forms[i].restore( result.grid );
+    }
+  });
+
+  for ( size_t i = 0; i < solved.size(); ++i )
+  {
+    if ( solved[i].finished() )
+    {
+      cache[forms[unsolved_first[i]].key()] = solved[i];
+    }
   }
+  return results;
+}
+
+// solve file
+// solves every grid in a file, printing each one and then the totals. With show_stats each grid is
+// followed by the solver's stats for it, and the totals by the stats for the whole file. Repeated
+// puzzles are only solved once, through solve_batch(), unless stats are wanted for every grid or
+// repeats aren't looked for, which for a file without them saves bringing each grid to form. With a
+// time limit a grid that takes longer is printed as far as the logic got, and counted as timed out.
+// With packed output only the grids' records go to standard output, and the rest goes to standard error.
+//
+//@param file name, number of threads, whether to print stats, whether to look for repeated puzzles,
+//       techniques to use, time limit for each grid, zero for none, input and output formats
+//@return exit code
+int solve_file( const _TCHAR* file_name, int threads, bool show_stats, bool repeats, Technique::SetT techniques, Clock::duration time_limit,
+                Format input, Format output )
+{
+  using namespace std;
 
-  ifstream grids_io( argv[1] );
+  // the file is mapped and parsed in place, either "Grid NN" blocks or one puzzle per line, or packed
+  MappedFile grids_file( file_name );
+  ostream& report = output == PACKED ? cerr : cout;
   
-  if (!grids_io)
+  if (!grids_file.open())
   {
-    cout << "bad file: " << argv[1] << endl;
+    report << "bad file: " << file_name << endl;
     return 1;
   }
+  if ( output == PACKED )
+  {
+    binary_output();
+  }
   int count_solved   = 0;
   int count_unsolved = 0;
-  char line[  Grid::SIZE_GRID ];
-  int cumulative = 0;
-  while ( !grids_io.eof() )
+  int count_timed_out = 0;
+  long long cumulative = 0;
+  vector<Grid> grids;
+  Stats total_stats;
+  SolveOptions options;
+  options.threads    = threads;
+  options.instrument = show_stats;
+  options.techniques = techniques;
+  options.solve_time_limit = time_limit;
+  const Solver solver( options );
+  SolveCache cache;
+  GridReader reader( grids_file, input );
+  while ( read_grids( reader, grids, BATCH_SIZE ) > 0 )
   {
-    grids_io.getline( line,  Grid::get_size() );
-    if ( strstr( line, "Grid" ) != 0 )
-    {
-      Grid a_grid;
-      grids_io >> a_grid;
+    // the grids are independent, so solve them all at once and then report them in input order
+    vector<SolveResult> results = show_stats || !repeats ? solver.solve_all( grids ) : solve_batch( solver, grids, cache );
 
-      if( solve( a_grid ))
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+      Grid& a_grid = results[i].grid;
+      if( results[i].status == SolveResult::SOLVED )
       {
         ++count_solved;
       }
@@ -72,17 +278,709 @@ int _tmain(int argc, _TCHAR* argv[])
       {
         ++count_unsolved;
       }
+      if( results[i].status == SolveResult::TIMED_OUT )
+      {
+        ++count_timed_out;
+      }
       
-      std::cout << a_grid;
-      std::cout << " " << std::endl;
-      std::cout << " " << std::endl;
+      if( output == PACKED )
+      {
+        PackedGrid::write( std::cout, a_grid );
+      }
+      else
+      {
+        std::cout << a_grid;
+      }
+      if( show_stats )
+      {
+        report << "stats: " << results[i].stats << std::endl;
+        total_stats += results[i].stats;
+      }
+      if( output != PACKED )
+      {
+        std::cout << " " << std::endl;
+        std::cout << " " << std::endl;
+      }
       cumulative += euler_number_calc( a_grid );
     }
   }
+  std::cout.flush();
 
-  std::cout << "solved: "<< count_solved << std::endl;
-  std::cout << "unsolved: "<< count_unsolved << std::endl;
-  std::cout << "number: " << cumulative << std::endl;
+  report << "solved: "<< count_solved << std::endl;
+  report << "unsolved: "<< count_unsolved << std::endl;
+  if( time_limit > Clock::duration::zero() )
+  {
+    report << "timed out: " << count_timed_out << std::endl;
+  }
+  report << "number: " << cumulative << std::endl;
+  if( show_stats )
+  {
+    report << "stats: " << total_stats << std::endl;
+  }
 	return 0;
 }
 
+// solve sized file
+// solves every grid in a file of boards with subgrids of SUBGRID x SUBGRID cells, printing each one and
+// then the totals, or with check, counts the solutions of each as check_file() does. The Solver is for
+// 9x9 boards, so these are solved by the grid itself, but the same way: shared between threads, logic
+// first and then guessing, and with a time limit a grid that takes longer is counted as timed out and
+// printed as far as the logic got.
+//
+//@param file name, number of threads, whether to check for unique solutions, techniques to use, time
+//       limit for each grid, zero for none
+//@return exit code, with check 1 unless every grid has a unique solution
+template <int SUBGRID>
+int solve_sized_file( const _TCHAR* file_name, int threads, bool check, Technique::SetT techniques, Clock::duration time_limit )
+{
+  using namespace std;
+  typedef BasicGrid<SUBGRID> GridT;
+
+  MappedFile grids_file( file_name );
+  if (!grids_file.open())
+  {
+    cout << "bad file: " << file_name << endl;
+    return 1;
+  }
+  // batches take as much memory as the 9x9 ones
+  const size_t batch_size = BATCH_SIZE * Grid::NUM_CELLS / GridT::NUM_CELLS;
+  const bool   guessing   = ( techniques & Technique::bit( Technique::SOLVE_BY_GUESSING )) != 0;
+  int count_solved    = 0;
+  int count_unsolved  = 0;
+  int count_unique    = 0;
+  int count_multiple  = 0;
+  int count_timed_out = 0;
+  int grid_number     = 0;
+  vector<GridT> grids;
+  vector<SolveResult::Status> status;
+  vector<int> solutions;
+  GridT grid;
+  MappedReader<BasicPuzzleReader<GridT>> reader( grids_file );
+  for ( bool more = true; more; )
+  {
+    grids.clear();
+    while ( grids.size() < batch_size && ( more = reader.next( grid )))
+    {
+      grids.push_back( grid );
+    }
+    status.assign( grids.size(), SolveResult::UNSOLVED );
+    solutions.assign( grids.size(), 0 );
+    parallel_for( grids.size(), threads, [&]( size_t i )
+    {
+      const Deadline limit = Deadline::after( time_limit );
+      const Deadline* deadline = limit.limited() ? &limit : 0;
+      GridT& puzzle = grids[i];
+      bool solved = puzzle.solve( 0, 0, techniques, deadline );
+      const GridT logic = puzzle;
+      bool finished = solved;
+      if ( check )
+      {
+        solutions[i] = solved ? 1 : puzzle.count_solutions( 2, 0, 0, techniques, deadline );
+        finished = solved || solutions[i] >= 2;
+        solved   = solutions[i] > 0;
+      }
+      else if ( !solved && guessing )
+      {
+        solved   = puzzle.solve_by_guessing( 0, 0, techniques, deadline );
+        finished = solved;
+      }
+      status[i] = solved ? SolveResult::SOLVED : SolveResult::UNSOLVED;
+      if ( deadline && !finished && deadline->gave_up() )
+      {
+        status[i] = SolveResult::TIMED_OUT;
+        puzzle    = logic;
+      }
+    });
+
+    for ( size_t i = 0; i < grids.size(); ++i )
+    {
+      if ( check )
+      {
+        cout << "Grid " << ++grid_number << ": ";
+        if ( status[i] == SolveResult::TIMED_OUT )
+        {
+          ++count_timed_out;
+          cout << "timed out" << endl;
+        }
+        else if ( solutions[i] == 1 )
+        {
+          ++count_unique;
+          cout << "unique" << endl;
+        }
+        else if ( solutions[i] > 1 )
+        {
+          ++count_multiple;
+          cout << "multiple solutions" << endl;
+        }
+        else
+        {
+          ++count_unsolved;
+          cout << "no solution" << endl;
+        }
+        continue;
+      }
+      if ( status[i] == SolveResult::SOLVED )
+      {
+        ++count_solved;
+      }
+      else
+      {
+        ++count_unsolved;
+      }
+      if ( status[i] == SolveResult::TIMED_OUT )
+      {
+        ++count_timed_out;
+      }
+      cout << grids[i];
+      cout << " " << endl;
+      cout << " " << endl;
+    }
+  }
+
+  if ( check )
+  {
+    cout << "unique: "   << count_unique   << endl;
+    cout << "multiple: " << count_multiple << endl;
+    cout << "none: "     << count_unsolved << endl;
+  }
+  else
+  {
+    cout << "solved: "   << count_solved   << endl;
+    cout << "unsolved: " << count_unsolved << endl;
+  }
+  if ( time_limit > Clock::duration::zero() )
+  {
+    cout << "timed out: " << count_timed_out << endl;
+  }
+  return ( !check || ( count_multiple == 0 && count_unsolved == 0 && count_timed_out == 0 )) ? 0 : 1;
+}
+
+// check file
+// counts the solutions of every grid in a file, stopping at two, and prints whether each has a unique
+// solution, several or none, followed by the totals. A grid that takes longer than the time limit is
+// counted as timed out.
+//
+//@param file name, number of threads, techniques to use, time limit for each grid, zero for none,
+//       input format
+//@return exit code, 1 unless every grid has a unique solution
+int check_file( const _TCHAR* file_name, int threads, Technique::SetT techniques, Clock::duration time_limit, Format input )
+{
+  using namespace std;
+
+  MappedFile grids_file( file_name );
+  if (!grids_file.open())
+  {
+    cout << "bad file: " << file_name << endl;
+    return 1;
+  }
+  int count_unique   = 0;
+  int count_multiple = 0;
+  int count_none     = 0;
+  int count_timed_out = 0;
+  int grid_number    = 0;
+  vector<Grid> grids;
+  SolveOptions options;
+  options.threads        = threads;
+  options.techniques     = techniques;
+  options.solve_time_limit = time_limit;
+  options.solution_limit = 2;
+  const Solver solver( options );
+  GridReader reader( grids_file, input );
+  while ( read_grids( reader, grids, BATCH_SIZE ) > 0 )
+  {
+    vector<SolveResult> results = solver.solve_all( grids );
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+      cout << "Grid " << ++grid_number << ": ";
+      if ( results[i].status == SolveResult::TIMED_OUT )
+      {
+        ++count_timed_out;
+        cout << "timed out" << endl;
+      }
+      else if ( results[i].unique() )
+      {
+        ++count_unique;
+        cout << "unique" << endl;
+      }
+      else if ( results[i].solutions > 1 )
+      {
+        ++count_multiple;
+        cout << "multiple solutions" << endl;
+      }
+      else
+      {
+        ++count_none;
+        cout << "no solution" << endl;
+      }
+    }
+  }
+
+  cout << "unique: "   << count_unique   << endl;
+  cout << "multiple: " << count_multiple << endl;
+  cout << "none: "     << count_none     << endl;
+  if ( time_limit > Clock::duration::zero() )
+  {
+    cout << "timed out: " << count_timed_out << endl;
+  }
+  return ( count_multiple == 0 && count_none == 0 && count_timed_out == 0 ) ? 0 : 1;
+}
+
+// benchmark
+// solves every grid in a file runs times, timing each solve on its own, and reports the throughput and
+// the spread of the latencies. They are solved runs times more through solve_all(), swept a batch at a
+// time, for the throughput of a bulk job. The grids are then solved once more on one thread with the
+// technique timings and stats switched on, so that reading the clock inside the solver doesn't distort
+// the latencies.
+//
+//@param file name, number of runs, number of threads, techniques to use, input format
+//@return exit code
+int benchmark_file( const _TCHAR* file_name, int runs, int threads, Technique::SetT techniques, Format input )
+{
+  using namespace std;
+  typedef Timings::ClockT ClockT;
+
+  MappedFile grids_file( file_name );
+  if (!grids_file.open())
+  {
+    cout << "bad file: " << file_name << endl;
+    return 1;
+  }
+  vector<Grid> puzzles;
+  GridReader reader( grids_file, input );
+  read_grids( reader, puzzles, static_cast<size_t>( -1 ));
+  if ( puzzles.empty() )
+  {
+    cout << file_name << ": no grids" << endl;
+    return 1;
+  }
+
+  const size_t count = puzzles.size();
+  vector<ClockT::duration> latencies( count * runs );
+  vector<char> solved( count );
+  SolveOptions options;
+  options.techniques = techniques;
+  const Solver solver( options );
+  const ClockT::time_point start = ClockT::now();
+  for ( int run = 0; run < runs; ++run )
+  {
+    parallel_for( count, threads, [&]( size_t i )
+    {
+      const SolveResult result = solver.solve( puzzles[i] );
+      solved[i] = result.status == SolveResult::SOLVED;
+      latencies[( run * count ) + i] = result.time;
+    });
+  }
+  const ClockT::duration elapsed = ClockT::now() - start;
+
+  SolveOptions batched( options );
+  batched.threads = threads;
+  const Solver batch_solver( batched );
+  const ClockT::time_point batch_start = ClockT::now();
+  for ( int run = 0; run < runs; ++run )
+  {
+    batch_solver.solve_all( puzzles );
+  }
+  const ClockT::duration batch_elapsed = ClockT::now() - batch_start;
+
+  Timings timings;
+  Stats   stats;
+  SolveOptions instrumented( options );
+  instrumented.instrument = true;
+  const Solver instrumented_solver( instrumented );
+  for ( const Grid& puzzle : puzzles )
+  {
+    const SolveResult result = instrumented_solver.solve( puzzle );
+    timings += result.timings;
+    stats   += result.stats;
+  }
+
+  sort( latencies.begin(), latencies.end() );
+  const size_t solves   = latencies.size();
+  const size_t unsolved = static_cast<size_t>( count_if( solved.begin(), solved.end(), []( char s ){ return !s; } ));
+  ClockT::duration technique_total = ClockT::duration::zero();
+  for ( int i = 0; i < Technique::SOLVE_BY_GUESSING; ++i )
+  {
+    technique_total += timings.get( static_cast<Technique::Type>( i ));
+  }
+
+  cout << file_name << ": " << count << " grids x " << runs << " runs on " << threads << ( threads == 1 ? " thread, " : " threads, " )
+       << unsolved << " unsolved, " << Grid::UnitScanT::kernel_name( Grid::UnitScanT::best_kernel() ) << " unit scan" << endl;
+  cout << "  " << solves / chrono::duration<double>( elapsed ).count() << " puzzles/sec, "
+       << format_time( elapsed ) << " in total" << endl;
+  cout << "  latency p50: " << format_time( latencies[solves / 2] )
+       << ", p99: "         << format_time( latencies[min( solves - 1, ( solves * 99 ) / 100 )] )
+       << ", max: "         << format_time( latencies.back() ) << endl;
+  cout << "  batch: " << solves / chrono::duration<double>( batch_elapsed ).count() << " puzzles/sec, ";
+  if ( BatchSweep::available() )
+  {
+    cout << Grid::UnitScanT::kernel_name( BatchSweep::kernel() ) << " sweep of " << BatchSweep::LANES << " lanes" << endl;
+  }
+  else
+  {
+    cout << "no batch sweep" << endl;
+  }
+  for ( int i = 0; i < Technique::NUM_TECHNIQUES; ++i )
+  {
+    const Technique::Type technique = static_cast<Technique::Type>( i );
+    cout << "  " << Technique::name( technique ) << ": " << format_time( timings.get( technique ));
+    if ( technique != Technique::SOLVE_BY_GUESSING && technique_total.count() > 0 )
+    {
+      cout << " (" << ( timings.get( technique ).count() * 100.0 ) / technique_total.count() << "%)";
+    }
+    cout << endl;
+  }
+  cout << "  stats: " << stats << endl;
+  return 0;
+}
+
+// convert file
+// writes every grid in a file to standard output in another format without solving it, as packed
+// records or as one line of digits each
+//
+//@param file name, input and output formats
+//@return exit code
+int convert_file( const _TCHAR* file_name, Format input, Format output )
+{
+  using namespace std;
+
+  MappedFile grids_file( file_name );
+  if (!grids_file.open())
+  {
+    cerr << "bad file: " << file_name << endl;
+    return 1;
+  }
+  if ( output == PACKED )
+  {
+    binary_output();
+  }
+  GridReader reader( grids_file, input );
+  Grid grid;
+  while ( reader.next( grid ))
+  {
+    if ( output == PACKED )
+    {
+      PackedGrid::write( cout, grid );
+    }
+    else
+    {
+      write_line( cout, grid );
+    }
+  }
+  cout.flush();
+  return 0;
+}
+
+// serve
+// runs the solver as a service, on standard input and output or on a port, until the input ends or the
+// process is stopped
+//
+//@param "-" or the port, number of threads, techniques to use, time limit for each request, zero for none
+//@return exit code
+int serve( const _TCHAR* where, int threads, Technique::SetT techniques, Clock::duration time_limit )
+{
+  using namespace std;
+
+  SolveOptions options;
+  options.techniques       = techniques;
+  options.solve_time_limit = time_limit;
+  SolveServer server( options, threads );
+  if ( _tcscmp( where, _T( "-" )) == 0 )
+  {
+    serve_file( server, stdin, stdout );
+    return 0;
+  }
+  const int port = _ttoi( where );
+  if ( !serve_socket( server, port ))
+  {
+    cerr << "can't listen on port " << port << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// generate
+// makes count puzzles with unique solutions and prints them, in the "Grid NN" layout or packed, followed
+// by the number of each rating on standard error. With a level only the puzzles of that rating are kept,
+// and puzzles are made until there are enough of them. Puzzle i of a run comes from seed and i, so a run
+// makes the same puzzles on any number of threads.
+//
+//@param number of puzzles, level to keep, NUM_LEVELS for any, seed, number of threads, output format
+//@return exit code
+int generate( int count, Rating::Level level, unsigned int seed, int threads, Format output )
+{
+  using namespace std;
+
+  if ( output == PACKED )
+  {
+    binary_output();
+  }
+  int made = 0;
+  int levels[Rating::NUM_LEVELS] = {};
+  unsigned int index = 0;
+  while ( made < count )
+  {
+    // each round makes enough for what's left if every attempt is kept, but at least a few per thread
+    const size_t round = static_cast<size_t>( max( count - made, 4 * threads ));
+    vector<Grid> puzzles( round );
+    vector<Rating::Level> ratings( round );
+    parallel_for( round, threads, [&]( size_t i )
+    {
+      Generator generator( seed, index + static_cast<unsigned int>( i ));
+      puzzles[i] = generator.puzzle( generator.solution() );
+      ratings[i] = Generator::rate( puzzles[i] ).level;
+    }, 1 );
+    index += static_cast<unsigned int>( round );
+
+    for ( size_t i = 0; i < round && made < count; ++i )
+    {
+      if ( level != Rating::NUM_LEVELS && ratings[i] != level )
+      {
+        continue;
+      }
+      ++levels[ratings[i]];
+      if ( output == PACKED )
+      {
+        PackedGrid::write( cout, puzzles[i] );
+        ++made;
+        continue;
+      }
+      char header[32];
+      snprintf( header, sizeof( header ), "Grid %02d\n", ++made );
+      cout << header;
+      for ( int row = 0; row < Grid::SIZE_GRID; ++row )
+      {
+        for ( int col = 0; col < Grid::SIZE_GRID; ++col )
+        {
+          const Cell& analysed_cell = puzzles[i].cell( row, col );
+          cout << static_cast<char>( '0' + ( analysed_cell.solved() ? analysed_cell.get_solution() : 0 ));
+        }
+        cout << '\n';
+      }
+    }
+  }
+  cout.flush();
+
+  for ( int i = 0; i < Rating::NUM_LEVELS; ++i )
+  {
+    cerr << Rating::name( static_cast<Rating::Level>( i )) << ": " << levels[i] << endl;
+  }
+  cerr << "attempts: " << index << endl;
+  return 0;
+}
+
+// format of
+// the format a command line names
+//
+//@param the argument, format to set
+//@return false if it isn't "text" or "packed"
+bool format_of( const _TCHAR* name, Format& format )
+{
+  if ( _tcscmp( name, _T( "text" )) == 0 )
+  {
+    format = TEXT;
+    return true;
+  }
+  if ( _tcscmp( name, _T( "packed" )) == 0 )
+  {
+    format = PACKED;
+    return true;
+  }
+  return false;
+}
+
+// level of
+// the rating a command line names
+//
+//@param the argument, level to set
+//@return false if it isn't a rating's name
+bool level_of( const _TCHAR* name, Rating::Level& level )
+{
+  for ( int i = 0; i < Rating::NUM_LEVELS; ++i )
+  {
+    const char* level_name = Rating::name( static_cast<Rating::Level>( i ));
+    int k = 0;
+    while ( level_name[k] != 0 && name[k] == static_cast<_TCHAR>( level_name[k] ))
+    {
+      ++k;
+    }
+    if ( level_name[k] == 0 && name[k] == 0 )
+    {
+      level = static_cast<Rating::Level>( i );
+      return true;
+    }
+  }
+  return false;
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+  using namespace std;
+
+  // sudoku [-j threads] [-x] [-t ms] [-s] [-C] <file>
+  // sudoku [-j threads] [-x] [-t ms] -u <file>
+  // sudoku [-j threads] [-x] -b runs <file>...
+  // sudoku [-j threads] [-x] [-t ms] [-u] -n size <file>
+  // sudoku [-i format] [-o format] -c <file>
+  // sudoku [-j threads] [-x] [-t ms] -S -|port
+  // sudoku [-j threads] [-o format] [-l level] [-r seed] -g count
+  // -j 0 uses a thread per core, -x also looks for naked and hidden subsets, -s prints the solver's
+  // stats for each grid, -C solves every grid rather than looking for repeats to solve once, -u checks
+  // that each grid has a unique solution and -b benchmarks each file instead of printing the
+  // solutions. -t gives up on a grid after ms milliseconds and -n solves
+  // boards of another size, 4, 16 or 25 cells a side. -i and -o read and write text or packed grids,
+  // and -c converts a file from one to the other without solving it. -S serves requests on standard
+  // input, or on a port of the loopback interface, instead of solving a file, as Server.h describes.
+  // -g makes count new puzzles from seed, only those rated level if there is one
+  Technique::SetT techniques = Technique::DEFAULT;
+  Clock::duration time_limit = Clock::duration::zero();
+  int  size       = Grid::SIZE_GRID;
+  int  threads    = 1;
+  int  runs       = 0;
+  bool show_stats = false;
+  bool repeats    = true;
+  bool check      = false;
+  bool convert    = false;
+  const _TCHAR* server = 0;
+  int  generated  = 0;
+  Rating::Level level = Rating::NUM_LEVELS;
+  unsigned int seed   = 1;
+  Format input    = TEXT;
+  Format output   = TEXT;
+  int  arg        = 1;
+  for ( ; arg + 1 < argc; arg += 2 )
+  {
+    if ( _tcscmp( argv[arg], _T( "-s" )) == 0 )
+    {
+      // a flag on its own, step back so the loop only moves past it
+      show_stats = true;
+      --arg;
+    }
+    else if ( _tcscmp( argv[arg], _T( "-C" )) == 0 )
+    {
+      repeats = false;
+      --arg;
+    }
+    else if ( _tcscmp( argv[arg], _T( "-u" )) == 0 )
+    {
+      check = true;
+      --arg;
+    }
+    else if ( _tcscmp( argv[arg], _T( "-c" )) == 0 )
+    {
+      convert = true;
+      --arg;
+    }
+    else if ( _tcscmp( argv[arg], _T( "-i" )) == 0 && format_of( argv[arg + 1], input ))
+    {
+    }
+    else if ( _tcscmp( argv[arg], _T( "-o" )) == 0 && format_of( argv[arg + 1], output ))
+    {
+    }
+    else if ( _tcscmp( argv[arg], _T( "-g" )) == 0 )
+    {
+      generated = max( 1, _ttoi( argv[arg + 1] ));
+    }
+    else if ( _tcscmp( argv[arg], _T( "-r" )) == 0 )
+    {
+      seed = static_cast<unsigned int>( _ttoi( argv[arg + 1] ));
+    }
+    else if ( _tcscmp( argv[arg], _T( "-l" )) == 0 && level_of( argv[arg + 1], level ))
+    {
+    }
+    else if ( _tcscmp( argv[arg], _T( "-S" )) == 0 )
+    {
+      server = argv[arg + 1];
+    }
+    else if ( _tcscmp( argv[arg], _T( "-x" )) == 0 )
+    {
+      techniques |= Technique::bit( Technique::SOLVE_FOR_SUBSETS );
+      --arg;
+    }
+    else if ( _tcscmp( argv[arg], _T( "-j" )) == 0 )
+    {
+      threads = _ttoi( argv[arg + 1] );
+      if ( threads <= 0 )
+      {
+        threads = default_thread_count();
+      }
+    }
+    else if ( _tcscmp( argv[arg], _T( "-t" )) == 0 )
+    {
+      time_limit = std::chrono::milliseconds( max( 0, _ttoi( argv[arg + 1] )));
+    }
+    else if ( _tcscmp( argv[arg], _T( "-n" )) == 0 )
+    {
+      size = _ttoi( argv[arg + 1] );
+    }
+    else if ( _tcscmp( argv[arg], _T( "-b" )) == 0 )
+    {
+      runs = max( 1, _ttoi( argv[arg + 1] ));
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  // the other sizes are only solved or checked from a text file
+  const bool sized = size != Grid::SIZE_GRID;
+  if ( generated > 0 && arg == argc && !sized )
+  {
+    return generate( generated, level, seed, threads, output );
+  }
+
+  if ( server && !sized )
+  {
+    return serve( server, threads, techniques, time_limit );
+  }
+
+  if ( runs > 0 && arg < argc && !sized )
+  {
+    int result = 0;
+    for ( ; arg < argc; ++arg )
+    {
+      result |= benchmark_file( argv[arg], runs, threads, techniques, input );
+    }
+    return result;
+  }
+
+  if ( argc != arg + 1 || ( sized && ( show_stats || !repeats || convert || runs > 0 || generated > 0 || server || input == PACKED || output == PACKED )))
+  {
+    cout << "Usage: sudoku [-j threads] [-x] [-t ms] [-s] [-C] <file>" << endl;
+    cout << "       sudoku [-j threads] [-x] [-t ms] -u <file>" << endl;
+    cout << "       sudoku [-j threads] [-x] -b runs <file>..." << endl;
+    cout << "       sudoku [-j threads] [-x] [-t ms] [-u] -n size <file>" << endl;
+    cout << "       sudoku [-i text|packed] [-o text|packed] -c <file>" << endl;
+    cout << "       sudoku [-j threads] [-x] [-t ms] -S -|port" << endl;
+    cout << "       sudoku [-j threads] [-o text|packed] [-l easy|medium|hard|fiendish] [-r seed] -g count" << endl;
+    cout << "  -i and -o also choose the formats that grids are read and printed in" << endl;
+    return 1;
+  }
+
+  if ( convert )
+  {
+    return convert_file( argv[arg], input, output );
+  }
+
+  switch ( size )
+  {
+  case Grid::SIZE_GRID:
+    break;
+  case 4:
+    return solve_sized_file<2>( argv[arg], threads, check, techniques, time_limit );
+  case 16:
+    return solve_sized_file<4>( argv[arg], threads, check, techniques, time_limit );
+  case 25:
+    return solve_sized_file<5>( argv[arg], threads, check, techniques, time_limit );
+  default:
+    cout << "unsupported size: " << size << endl;
+    return 1;
+  }
+
+  if ( check )
+  {
+    return check_file( argv[arg], threads, techniques, time_limit, input );
+  }
+
+  return solve_file( argv[arg], threads, show_stats, repeats, techniques, time_limit, input, output );
+}